@@ -17,12 +17,18 @@
 #include <tegrabl_qspi.h>
 #include <tegrabl_soc_misc.h>
 #include <tegrabl_soc_clock.h>
+#include <string.h>
 
 #include <bpmp_abi.h>
 #include <clk-t194.h>
 #include <reset-t194.h>
 #include <powergate-t194.h>
 
+#if defined(CONFIG_ENABLE_CLK_SNAPSHOT)
+#include <libfdt.h>
+#include <tegrabl_malloc.h>
+#endif
+
 #define BPMP_CLK_CMD(cmd, id) ((id) | ((cmd) << 24))
 #define MODULE_NOT_SUPPORTED (TEGRA194_MAX_CLK_ID)
 #define MODULE_NOT_SUPPORTED_SKIPPED (TEGRA194_MAX_CLK_ID + 1)
@@ -79,6 +85,7 @@ static uint32_t tegrabl_pllid_to_bpmp_pllid[TEGRABL_CLK_PLL_ID_MAX] = {
 
 #define MOD_CLK                     0
 #define MOD_RST                     1
+#define MOD_PG                      2
 
 #define UART_MAX_INSTANCES_A2G      7
 #define SDMMC_MAX_INSTANCES_1TO4    4
@@ -194,7 +201,6 @@ static uint32_t qspi_module_div2_instances[QSPI_MAX_INSTANCES_1TO2][2] = {
 #define TEGRABL_XUSB_SS 3
 #define TEGRABL_XUSB_PADCTL 4
 #define XUSB_MAX_INSTANCES 5
-static uint32_t internal_xusb_index_map;
 
 static uint32_t xusb_module_instances[XUSB_MAX_INSTANCES][2] = {
 	{MODULE_NOT_SUPPORTED,  MODULE_NOT_SUPPORTED},
@@ -204,7 +210,7 @@ static uint32_t xusb_module_instances[XUSB_MAX_INSTANCES][2] = {
 	{MODULE_NOT_SUPPORTED,        TEGRA194_RESET_XUSB_PADCTL}
 };
 
-static enum {
+enum {
 	TEGRABL_RST_NVDISPLAY0_HEAD0,
 	TEGRABL_RST_NVDISPLAY0_HEAD1,
 	TEGRABL_RST_NVDISPLAY0_HEAD2,
@@ -241,7 +247,7 @@ static enum {
 	TEGRABL_NVDISP_DPAUX2,
 	TEGRABL_NVDISP_DPAUX3,
 	NVDISP_MAX_INSTANCES
-} index_nvdisp_map;
+};
 
 static uint32_t nvdisp_module_instance[NVDISP_MAX_INSTANCES][2] = {
 	{MODULE_NOT_SUPPORTED,         TEGRA194_RESET_NVDISPLAY0_HEAD0},
@@ -299,404 +305,172 @@ static uint32_t pwm_module_instances[PWM_MAX_INSTANCES][2] = {
 	{TEGRA194_CLK_PWM8, TEGRA194_RESET_PWM8},
 };
 
-static int32_t pcie_core_rst_map[] = {
-	TEGRA194_RESET_PEX0_CORE_0,
-	TEGRA194_RESET_PEX0_CORE_1,
-	TEGRA194_RESET_PEX0_CORE_2,
-	TEGRA194_RESET_PEX0_CORE_3,
-	TEGRA194_RESET_PEX0_CORE_4,
-	TEGRA194_RESET_PEX1_CORE_5,
+static uint32_t pcie_core_instances[][2] = {
+	{TEGRA194_CLK_PEX0_CORE_0, TEGRA194_RESET_PEX0_CORE_0},
+	{TEGRA194_CLK_PEX0_CORE_1, TEGRA194_RESET_PEX0_CORE_1},
+	{TEGRA194_CLK_PEX0_CORE_2, TEGRA194_RESET_PEX0_CORE_2},
+	{TEGRA194_CLK_PEX0_CORE_3, TEGRA194_RESET_PEX0_CORE_3},
+	{TEGRA194_CLK_PEX0_CORE_4, TEGRA194_RESET_PEX0_CORE_4},
+	{TEGRA194_CLK_PEX1_CORE_5, TEGRA194_RESET_PEX1_CORE_5},
+};
+
+static uint32_t pcie_apb_instances[][2] = {
+	{MODULE_NOT_SUPPORTED, TEGRA194_RESET_PEX0_CORE_0_APB},
+	{MODULE_NOT_SUPPORTED, TEGRA194_RESET_PEX0_CORE_1_APB},
+	{MODULE_NOT_SUPPORTED, TEGRA194_RESET_PEX0_CORE_2_APB},
+	{MODULE_NOT_SUPPORTED, TEGRA194_RESET_PEX0_CORE_3_APB},
+	{MODULE_NOT_SUPPORTED, TEGRA194_RESET_PEX0_CORE_4_APB},
+	{MODULE_NOT_SUPPORTED, TEGRA194_RESET_PEX1_CORE_5_APB},
+	{MODULE_NOT_SUPPORTED, TEGRA194_RESET_PEX0_COMMON_APB},
+};
+
+/* Power partition of each PCIe controller, C1-C3 share PCIEX1A */
+static const uint32_t pcie_pg_instances[] = {
+	TEGRA194_POWER_DOMAIN_PCIEX8B,
+	TEGRA194_POWER_DOMAIN_PCIEX1A,
+	TEGRA194_POWER_DOMAIN_PCIEX1A,
+	TEGRA194_POWER_DOMAIN_PCIEX1A,
+	TEGRA194_POWER_DOMAIN_PCIEX4A,
+	TEGRA194_POWER_DOMAIN_PCIEX8A,
+};
+
+static const uint32_t xusb_ss_pg = TEGRA194_POWER_DOMAIN_XUSBA;
+static const uint32_t xusb_dev_pg = TEGRA194_POWER_DOMAIN_XUSBB;
+static const uint32_t xusb_host_pg = TEGRA194_POWER_DOMAIN_XUSBC;
+
+/* Modules with a single clock/reset pair */
+enum {
+	TEGRABL_SINGLE_GPCDMA,
+	TEGRABL_SINGLE_SE,
+	TEGRABL_SINGLE_AUD_MCLK,
+	TEGRABL_SINGLE_SATA,
+	TEGRABL_SINGLE_SATACOLD,
+	TEGRABL_SINGLE_SATA_OOB,
+	TEGRABL_SINGLE_PCIE,
+	TEGRABL_SINGLE_PCIEXCLK,
+	TEGRABL_SINGLE_AFI,
+	TEGRABL_SINGLE_UFSDEV_REF,
+	TEGRABL_SINGLE_UFSHC_CG_SYS,
+	TEGRABL_SINGLE_AXI_CBB,
+	SINGLE_MAX_INSTANCES
+};
+
+static uint32_t single_module_instances[SINGLE_MAX_INSTANCES][2] = {
+	[TEGRABL_SINGLE_GPCDMA]       = {TEGRA194_CLK_GPCCLK,     TEGRA194_RESET_GPCDMA},
+	[TEGRABL_SINGLE_SE]           = {TEGRA194_CLK_SE,         TEGRA194_RESET_SE},
+	[TEGRABL_SINGLE_AUD_MCLK]     = {TEGRA194_CLK_AUD_MCLK,   MODULE_NOT_SUPPORTED},
+	[TEGRABL_SINGLE_SATA]         = {TEGRA194_CLK_SATA,       TEGRA194_RESET_SATA},
+	[TEGRABL_SINGLE_SATACOLD]     = {MODULE_NOT_SUPPORTED,    TEGRA194_RESET_SATACOLD},
+	[TEGRABL_SINGLE_SATA_OOB]     = {TEGRA194_CLK_SATA_OOB,   MODULE_NOT_SUPPORTED},
+	[TEGRABL_SINGLE_PCIE]         = {MODULE_NOT_SUPPORTED,    TEGRA194_RESET_PCIE},
+	[TEGRABL_SINGLE_PCIEXCLK]     = {MODULE_NOT_SUPPORTED,    TEGRA194_RESET_PCIEXCLK},
+	[TEGRABL_SINGLE_AFI]          = {MODULE_NOT_SUPPORTED,    TEGRA194_RESET_AFI},
+	[TEGRABL_SINGLE_UFSDEV_REF]   = {TEGRA194_CLK_UFSDEV_REF, MODULE_NOT_SUPPORTED},
+	[TEGRABL_SINGLE_UFSHC_CG_SYS] = {TEGRA194_CLK_UFSHC,      MODULE_NOT_SUPPORTED},
+	[TEGRABL_SINGLE_AXI_CBB]      = {TEGRA194_CLK_AXI_CBB,    MODULE_NOT_SUPPORTED},
 };
 
-static int32_t pcie_core_clk_map[] = {
-	TEGRA194_CLK_PEX0_CORE_0,
-	TEGRA194_CLK_PEX0_CORE_1,
-	TEGRA194_CLK_PEX0_CORE_2,
-	TEGRA194_CLK_PEX0_CORE_3,
-	TEGRA194_CLK_PEX0_CORE_4,
-	TEGRA194_CLK_PEX1_CORE_5,
+/**
+ * @brief BPMP ids of a module
+ *
+ * @param ids clk/rst ids, indexed by instance
+ * @param num_instances number of valid instances, 0 if the module has a single
+ *        instance and the instance argument is ignored
+ * @param pg_ids power partition ids, indexed like ids, NULL if the module is
+ *        not power gated by this driver
+ */
+struct module_bpmp_map {
+	uint32_t (*ids)[2];
+	uint8_t num_instances;
+	const uint32_t *pg_ids;
 };
 
-static int32_t pcie_apb_rst_map[] = {
-	TEGRA194_RESET_PEX0_CORE_0_APB,
-	TEGRA194_RESET_PEX0_CORE_1_APB,
-	TEGRA194_RESET_PEX0_CORE_2_APB,
-	TEGRA194_RESET_PEX0_CORE_3_APB,
-	TEGRA194_RESET_PEX0_CORE_4_APB,
-	TEGRA194_RESET_PEX1_CORE_5_APB,
-	TEGRA194_RESET_PEX0_COMMON_APB,
+#define MODULE_MAP(table, base, count) { &(table)[(base)], (count), NULL }
+#define MODULE_MAP_SINGLE(table, index) { &(table)[(index)], 0, NULL }
+
+/* Indexed by module id, modules without an entry are not supported */
+static const struct module_bpmp_map module_bpmp_maps[] = {
+	[TEGRABL_MODULE_UART] = MODULE_MAP(uart_module_instances, 0, UART_MAX_INSTANCES_A2G),
+	[TEGRABL_MODULE_SDMMC] = MODULE_MAP(sdmmc_module_instances, 0, SDMMC_MAX_INSTANCES_1TO4),
+	[TEGRABL_MODULE_GPCDMA] = MODULE_MAP_SINGLE(single_module_instances, TEGRABL_SINGLE_GPCDMA),
+	[TEGRABL_MODULE_QSPI] = MODULE_MAP(qspi_module_instances, 0, QSPI_MAX_INSTANCES_1TO2),
+	[TEGRABL_MODULE_I2C] = MODULE_MAP(i2c_module_instances, 0, I2C_MAX_INSTANCES_1TO14),
+	[TEGRABL_MODULE_XUSBF] = MODULE_MAP_SINGLE(xusb_module_instances, TEGRABL_XUSB),
+	[TEGRABL_MODULE_XUSB_DEV] = { &xusb_module_instances[TEGRABL_XUSB_DEV], 0, &xusb_dev_pg },
+	[TEGRABL_MODULE_XUSB_HOST] = { &xusb_module_instances[TEGRABL_XUSB_HOST], 0, &xusb_host_pg },
+	[TEGRABL_MODULE_XUSB_SS] = { &xusb_module_instances[TEGRABL_XUSB_SS], 0, &xusb_ss_pg },
+	[TEGRABL_MODULE_XUSB_PADCTL] = MODULE_MAP_SINGLE(xusb_module_instances, TEGRABL_XUSB_PADCTL),
+	[TEGRABL_MODULE_SOR] = MODULE_MAP(nvdisp_module_instance, TEGRABL_NVDISP_SOR0, 4),
+	[TEGRABL_MODULE_SOR_OUT] = MODULE_MAP(nvdisp_module_instance, TEGRABL_NVDISP_SOR0_OUT, 4),
+	[TEGRABL_MODULE_SOR_PAD_CLKOUT] = MODULE_MAP(nvdisp_module_instance, TEGRABL_NVDISP_SOR0_PAD_CLKOUT, 4),
+	[TEGRABL_MODULE_SOR_SAFE] = MODULE_MAP_SINGLE(nvdisp_module_instance, TEGRABL_NVDISP_SOR_SAFE),
+	[TEGRABL_MODULE_DPAUX] = MODULE_MAP_SINGLE(nvdisp_module_instance, TEGRABL_NVDISP_DPAUX),
+	[TEGRABL_MODULE_DPAUX1] = MODULE_MAP_SINGLE(nvdisp_module_instance, TEGRABL_NVDISP_DPAUX1),
+	[TEGRABL_MODULE_DPAUX2] = MODULE_MAP_SINGLE(nvdisp_module_instance, TEGRABL_NVDISP_DPAUX2),
+	[TEGRABL_MODULE_DPAUX3] = MODULE_MAP_SINGLE(nvdisp_module_instance, TEGRABL_NVDISP_DPAUX3),
+	[TEGRABL_MODULE_NVDISPLAYHUB] = MODULE_MAP_SINGLE(nvdisp_module_instance, TEGRABL_NVDISP_HUB),
+	[TEGRABL_MODULE_NVDISPLAY_DSC] = MODULE_MAP_SINGLE(nvdisp_module_instance, TEGRABL_NVDISP_DSC),
+	[TEGRABL_MODULE_NVDISPLAY_DISP] = MODULE_MAP_SINGLE(nvdisp_module_instance, TEGRABL_NVDISP_DISP),
+	[TEGRABL_MODULE_NVDISPLAY_P] = MODULE_MAP(nvdisp_module_instance, TEGRABL_NVDISP_P0, 4),
+	[TEGRABL_MODULE_HOST1X] = MODULE_MAP_SINGLE(nvdisp_module_instance, TEGRABL_NVDISP_HOST1X),
+	[TEGRABL_MODULE_NVDISPLAY0_HEAD] = MODULE_MAP(nvdisp_module_instance, TEGRABL_RST_NVDISPLAY0_HEAD0, 3),
+	[TEGRABL_MODULE_NVDISPLAY0_WGRP] = MODULE_MAP(nvdisp_module_instance, TEGRABL_RST_NVDISPLAY0_WGRP0, 6),
+	[TEGRABL_MODULE_NVDISPLAY0_MISC] = MODULE_MAP_SINGLE(nvdisp_module_instance, TEGRABL_RST_NVDISPLAY0_MISC),
+	[TEGRABL_MODULE_SE] = MODULE_MAP_SINGLE(single_module_instances, TEGRABL_SINGLE_SE),
+	[TEGRABL_MODULE_SPI] = MODULE_MAP(spi_module_instances, 0, SPI_MAX_INSTANCES_1TO4),
+	[TEGRABL_MODULE_AUD_MCLK] = MODULE_MAP_SINGLE(single_module_instances, TEGRABL_SINGLE_AUD_MCLK),
+	[TEGRABL_MODULE_SATA] = MODULE_MAP_SINGLE(single_module_instances, TEGRABL_SINGLE_SATA),
+	[TEGRABL_MODULE_SATACOLD] = MODULE_MAP_SINGLE(single_module_instances, TEGRABL_SINGLE_SATACOLD),
+	[TEGRABL_MODULE_SATA_OOB] = MODULE_MAP_SINGLE(single_module_instances, TEGRABL_SINGLE_SATA_OOB),
+	[TEGRABL_MODULE_PCIE] = MODULE_MAP_SINGLE(single_module_instances, TEGRABL_SINGLE_PCIE),
+	[TEGRABL_MODULE_PCIEXCLK] = MODULE_MAP_SINGLE(single_module_instances, TEGRABL_SINGLE_PCIEXCLK),
+	[TEGRABL_MODULE_AFI] = MODULE_MAP_SINGLE(single_module_instances, TEGRABL_SINGLE_AFI),
+	[TEGRABL_MODULE_MPHY] = MODULE_MAP(mphy_instances, 0, TEGRABL_CLK_MPHY_MAX_INSTANCES),
+	[TEGRABL_MODULE_UFS] = MODULE_MAP(ufs_instances, 0, TEGRABL_CLK_UFS_MAX_INSTANCES),
+	[TEGRABL_MODULE_UFSDEV_REF] = MODULE_MAP_SINGLE(single_module_instances, TEGRABL_SINGLE_UFSDEV_REF),
+	[TEGRABL_MODULE_UFSHC_CG_SYS] = MODULE_MAP_SINGLE(single_module_instances, TEGRABL_SINGLE_UFSHC_CG_SYS),
+	[TEGRABL_MODULE_EQOS] = MODULE_MAP(eqos_instances, 0, TEGRABL_CLK_EQOS_MAX_INSTANCES),
+	[TEGRABL_MODULE_AXI_CBB] = MODULE_MAP_SINGLE(single_module_instances, TEGRABL_SINGLE_AXI_CBB),
+	[TEGRABL_MODULE_PEX_USB_UPHY] = MODULE_MAP(pex_usb_instances, 0, TEGRABL_CLK_PEX_USB_UPHY_MAX_INSTANCES),
+	[TEGRABL_MODULE_PWM] = MODULE_MAP(pwm_module_instances, 0, PWM_MAX_INSTANCES),
+	[TEGRABL_MODULE_PCIE_CORE] = { pcie_core_instances, ARRAY_SIZE(pcie_core_instances), pcie_pg_instances },
+	[TEGRABL_MODULE_PCIE_APB] = MODULE_MAP(pcie_apb_instances, 0, ARRAY_SIZE(pcie_apb_instances)),
 };
 
 static int32_t tegrabl_module_to_bpmp_id(
 				tegrabl_module_t module_num,
 				uint8_t instance,
-				bool clk_or_rst)
+				uint32_t id_type)
 {
-	/* TODO - Complete below mapping */
-	switch (module_num) {
-	case (TEGRABL_MODULE_UART):
-	{
-		if (instance < UART_MAX_INSTANCES_A2G) {
-			return uart_module_instances[instance][clk_or_rst];
-		}
-		break;
-	}
-	case (TEGRABL_MODULE_SDMMC):
-	{
-		if (instance < SDMMC_MAX_INSTANCES_1TO4) {
-			return sdmmc_module_instances[instance][clk_or_rst];
-		}
-		break;
-	}
-	case (TEGRABL_MODULE_GPCDMA):
-	{
-		if (clk_or_rst == MOD_RST)
-			return TEGRA194_RESET_GPCDMA;
-		else if (clk_or_rst == MOD_CLK)
-			return TEGRA194_CLK_GPCCLK;
-		else
-			return MODULE_NOT_SUPPORTED;
-		break;
-	}
-	case (TEGRABL_MODULE_QSPI):
-	{
-		if (instance < QSPI_MAX_INSTANCES_1TO2) {
-			return qspi_module_instances[instance][clk_or_rst];
-		}
-		break;
-	}
-	case (TEGRABL_MODULE_I2C):
-	{
-		if (instance < I2C_MAX_INSTANCES_1TO14) {
-			return i2c_module_instances[instance][clk_or_rst];
-		}
-		break;
-	}
-	case (TEGRABL_MODULE_XUSBF):
-	{
-		internal_xusb_index_map = TEGRABL_XUSB;
-		return xusb_module_instances[internal_xusb_index_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_XUSB_DEV):
-	{
-		internal_xusb_index_map = TEGRABL_XUSB_DEV;
-		return xusb_module_instances[internal_xusb_index_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_XUSB_HOST):
-	{
-		internal_xusb_index_map = TEGRABL_XUSB_HOST;
-		return xusb_module_instances[internal_xusb_index_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_XUSB_SS):
-	{
-		internal_xusb_index_map = TEGRABL_XUSB_SS;
-		return xusb_module_instances[internal_xusb_index_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_XUSB_PADCTL):
-	{
-		internal_xusb_index_map = TEGRABL_XUSB_PADCTL;
-		return xusb_module_instances[internal_xusb_index_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_SOR):
-	{
-		if (instance > 3) /* SOR0, SOR1, SOR2, SOR3 */ {
-			return MODULE_NOT_SUPPORTED;
-		}
-		/* index w.r.t SOR0 */
-		index_nvdisp_map = TEGRABL_NVDISP_SOR0 + instance;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_SOR_OUT):
-	{
-		if (instance > 3) /* SOR0_OUT, SOR1_OUT, SOR2_OUT, SOR3_OUT */ {
-			return MODULE_NOT_SUPPORTED;
-		}
-		/* index w.r.t SOR0_OUT */
-		index_nvdisp_map = TEGRABL_NVDISP_SOR0_OUT + instance;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_SOR_PAD_CLKOUT):
-	{
-		if (instance > 3) /* SOR0_PAD_CLKOUT, SOR1_PAD_CLKOUT, SOR2_PAD_CLKOUT, SOR3_PAD_CLKOUT */ {
-			return MODULE_NOT_SUPPORTED;
-		}
-		/* index w.r.t SOR0_PAD_CLKOUT */
-		index_nvdisp_map = TEGRABL_NVDISP_SOR0_PAD_CLKOUT + instance;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_SOR_SAFE):
-	{
-		index_nvdisp_map = TEGRABL_NVDISP_SOR_SAFE;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_DPAUX):
-	{
-		index_nvdisp_map = TEGRABL_NVDISP_DPAUX;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_DPAUX1):
-	{
-		index_nvdisp_map = TEGRABL_NVDISP_DPAUX1;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_DPAUX2):
-	{
-		index_nvdisp_map = TEGRABL_NVDISP_DPAUX2;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_DPAUX3):
-	{
-		index_nvdisp_map = TEGRABL_NVDISP_DPAUX3;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_NVDISPLAYHUB):
-	{
-		index_nvdisp_map = TEGRABL_NVDISP_HUB;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_NVDISPLAY_DSC):
-	{
-		index_nvdisp_map = TEGRABL_NVDISP_DSC;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_NVDISPLAY_DISP):
-	{
-		index_nvdisp_map = TEGRABL_NVDISP_DISP;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_NVDISPLAY_P):
-	{
-		if (instance > 3) /* P0 to P3 */ {
-			return MODULE_NOT_SUPPORTED;
-		}
-		/* index w.r.t P0 */
-		index_nvdisp_map = TEGRABL_NVDISP_P0 + instance;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_HOST1X):
-	{
-		index_nvdisp_map = TEGRABL_NVDISP_HOST1X;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_NVDISPLAY0_HEAD):
-	{
-		if (instance > 2) /* HEAD0 to HEAD2 */ {
-			return MODULE_NOT_SUPPORTED;
-		}
-		/* index w.r.t HEAD0 */
-		index_nvdisp_map =
-					(TEGRABL_RST_NVDISPLAY0_HEAD0 + instance);
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_NVDISPLAY0_WGRP):
-	{
-		if (instance > 5) /* WGRP0 to WGRP5 */ {
-			return MODULE_NOT_SUPPORTED;
-		}
-		/* index w.r.t WGRP0 */
-		index_nvdisp_map =
-					(TEGRABL_RST_NVDISPLAY0_WGRP0 + instance);
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case (TEGRABL_MODULE_NVDISPLAY0_MISC):
-	{
-		index_nvdisp_map = TEGRABL_RST_NVDISPLAY0_MISC;
-		return nvdisp_module_instance[index_nvdisp_map][clk_or_rst];
-		break;
-	}
-	case TEGRABL_MODULE_SE:
-	{
-		switch (clk_or_rst) {
-		case MOD_RST:
-			return TEGRA194_RESET_SE;
-			break;
-		case MOD_CLK:
-			return TEGRA194_CLK_SE;
-			break;
-		}
-		break;
-	}
-	case TEGRABL_MODULE_SPI:
-	{
-		if (instance < SPI_MAX_INSTANCES_1TO4) {
-			return spi_module_instances[instance][clk_or_rst];
-		}
-		break;
-	}
-	case TEGRABL_MODULE_AUD_MCLK:
-	{
-		switch (clk_or_rst) {
-		case MOD_RST:
-			return MODULE_NOT_SUPPORTED;
-			break;
-		case MOD_CLK:
-			return TEGRA194_CLK_AUD_MCLK;
-			break;
-		}
-		break;
-	}
-	case TEGRABL_MODULE_SATA:
-	{
-		switch (clk_or_rst) {
-		case MOD_RST:
-			return TEGRA194_RESET_SATA;
-			break;
-		case MOD_CLK:
-			return TEGRA194_CLK_SATA;
-			break;
-		}
-		break;
-	}
-	case TEGRABL_MODULE_SATACOLD:
-	{
-		switch (clk_or_rst) {
-		case MOD_RST:
-			return TEGRA194_RESET_SATACOLD;
-			break;
-		}
-		break;
-	}
-	case TEGRABL_MODULE_SATA_OOB:
-	{
-		switch (clk_or_rst) {
-		case MOD_CLK:
-			return TEGRA194_CLK_SATA_OOB;
-			break;
-		}
-		break;
-	}
-	case TEGRABL_MODULE_PCIE:
-	{
-		switch (clk_or_rst) {
-		case MOD_RST:
-			return TEGRA194_RESET_PCIE;
-			break;
-		}
-		break;
-	}
-	case TEGRABL_MODULE_PCIEXCLK:
-	{
-		switch (clk_or_rst) {
-		case MOD_RST:
-			return TEGRA194_RESET_PCIEXCLK;
-			break;
-		}
-		break;
-	}
-	case TEGRABL_MODULE_AFI:
-	{
-		switch (clk_or_rst) {
-		case MOD_RST:
-			return TEGRA194_RESET_AFI;
-			break;
-		}
-		break;
-	}
-	case TEGRABL_MODULE_MPHY:
-	{
-		if (instance < TEGRABL_CLK_MPHY_MAX_INSTANCES) {
-			return mphy_instances[instance][clk_or_rst];
-		}
-		break;
-	}
-	case TEGRABL_MODULE_UFS:
-	{
-		if (instance < TEGRABL_CLK_UFS_MAX_INSTANCES) {
-			return ufs_instances[instance][clk_or_rst];
-		}
-		break;
-	}
-	case TEGRABL_MODULE_UFSDEV_REF:
-	{
-		if (clk_or_rst == MOD_CLK) {
-			return TEGRA194_CLK_UFSDEV_REF;
-		}
-		break;
-	}
-	case TEGRABL_MODULE_UFSHC_CG_SYS:
-	{
-		if (clk_or_rst == MOD_CLK) {
-			return TEGRA194_CLK_UFSHC;
-		}
-		break;
-	}
-	case TEGRABL_MODULE_EQOS:
-	{
-		if (instance < TEGRABL_CLK_EQOS_MAX_INSTANCES) {
-			return eqos_instances[instance][clk_or_rst];
-		}
-		break;
-	}
-	case TEGRABL_MODULE_AXI_CBB:
-	{
-		if (clk_or_rst == MOD_CLK) {
-			return TEGRA194_CLK_AXI_CBB;
-		}
-		break;
-	}
-	case TEGRABL_MODULE_PEX_USB_UPHY:
-	{
-		if (instance < TEGRABL_CLK_PEX_USB_UPHY_MAX_INSTANCES) {
-			return pex_usb_instances[instance][clk_or_rst];
-		}
-		break;
-	}
-	case TEGRABL_MODULE_PWM:
-	{
-		if (instance < PWM_MAX_INSTANCES) {
-			return pwm_module_instances[instance][clk_or_rst];
-		}
-		break;
+	const struct module_bpmp_map *map;
+
+	if ((uint32_t)module_num >= ARRAY_SIZE(module_bpmp_maps)) {
+		return MODULE_NOT_SUPPORTED;
 	}
-	case TEGRABL_MODULE_PCIE_CORE:
-	{
-		switch (clk_or_rst) {
-		case MOD_RST:
-			if (instance < ARRAY_SIZE(pcie_core_rst_map)) {
-				return pcie_core_rst_map[instance];
-			}
-			break;
-		case MOD_CLK:
-			if (instance < ARRAY_SIZE(pcie_core_clk_map)) {
-				return pcie_core_clk_map[instance];
-			}
-			break;
-		}
-		break;
+
+	map = &module_bpmp_maps[module_num];
+	if (map->ids == NULL) {
+		return MODULE_NOT_SUPPORTED;
 	}
-	case TEGRABL_MODULE_PCIE_APB:
-	{
-		if (clk_or_rst == MOD_RST) {
-			if (instance < ARRAY_SIZE(pcie_apb_rst_map)) {
-				return pcie_apb_rst_map[instance];
-			}
-		}
-		break;
+
+	if (map->num_instances == 0U) {
+		instance = 0;
+	} else if (instance >= map->num_instances) {
+		return MODULE_NOT_SUPPORTED;
 	}
-	default:
-		break;
+
+	if (id_type == MOD_PG) {
+		return (map->pg_ids != NULL) ? (int32_t)map->pg_ids[instance] : MODULE_NOT_SUPPORTED;
 	}
-	return MODULE_NOT_SUPPORTED;
+
+	return (int32_t)map->ids[instance][id_type];
+}
+
+uint32_t tegrabl_car_get_pg_id(tegrabl_module_t module, uint8_t instance)
+{
+	int32_t pg_id = tegrabl_module_to_bpmp_id(module, instance, MOD_PG);
+
+	return (pg_id == MODULE_NOT_SUPPORTED) ? TEGRABL_PG_ID_NONE : (uint32_t)pg_id;
 }
 
 static tegrabl_clk_src_id_t src_clk_bpmp_to_tegrabl(uint32_t src)
@@ -853,6 +627,378 @@ static uint32_t src_clk_tegrabl_to_bpmp(tegrabl_clk_src_id_t src)
 	}
 }
 
+/* Bitmap of BPMP clock ids */
+#define CLK_MAP_WORDS ((TEGRA194_MAX_CLK_ID + 31U) / 32U)
+
+static void clk_map_mark(uint32_t *map, uint32_t clk_id)
+{
+	if (clk_id < TEGRA194_MAX_CLK_ID) {
+		map[clk_id / 32U] |= (1UL << (clk_id % 32U));
+	}
+}
+
+static void clk_map_mark_table(uint32_t *map, uint32_t (*table)[2], uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		clk_map_mark(map, table[i][MOD_CLK]);
+	}
+}
+
+static bool clk_map_is_marked(const uint32_t *map, uint32_t clk_id)
+{
+	return (map[clk_id / 32U] & (1UL << (clk_id % 32U))) != 0U;
+}
+
+/* Mark the clocks referenced by the module to BPMP id mapping */
+static void clk_map_mark_modules(uint32_t *map)
+{
+	uint32_t num_instances;
+	uint32_t i;
+
+	for (i = 0; i < ARRAY_SIZE(module_bpmp_maps); i++) {
+		if (module_bpmp_maps[i].ids != NULL) {
+			num_instances = module_bpmp_maps[i].num_instances;
+			clk_map_mark_table(map, module_bpmp_maps[i].ids, (num_instances != 0U) ? num_instances : 1U);
+		}
+	}
+#if defined(CONFIG_ENABLE_QSPI)
+	clk_map_mark_table(map, qspi_module_div2_instances, ARRAY_SIZE(qspi_module_div2_instances));
+#endif
+}
+
+/*
+ * Write-through shadow of the clock state held by BPMP, indexed by BPMP clock
+ * id. On the first lookup, the state, rate and parent of all the clocks of
+ * the module mapping, and the parents of their ancestors, are read from BPMP
+ * in a single pass (see clk_cache_fill), and then served locally. The
+ * operations of this driver drop only what they may change: a rate or parent
+ * change drops the rate of the clock and of its descendants, an enable or
+ * disable drops the state of the ancestors of the clock, which BPMP enables
+ * and disables along, and a reset drops the clock of the module. A clock whose
+ * ancestry is not known is assumed to be affected. Dropped fields are read
+ * from BPMP again on their next lookup.
+ */
+#define CLK_CACHE_RATE_VALID	(1U << 0)
+#define CLK_CACHE_PARENT_VALID	(1U << 1)
+#define CLK_CACHE_STATE_VALID	(1U << 2)
+#define CLK_CACHE_ENABLED		(1U << 3)
+
+/* Longest parent chain followed, deeper ones are assumed to contain any clock */
+#define CLK_CACHE_MAX_DEPTH		16U
+/* Parent of a clock which has none */
+#define CLK_CACHE_NO_PARENT		TEGRA194_MAX_CLK_ID
+
+struct clk_cache_entry {
+	uint32_t rate_khz;
+	uint16_t parent;
+	uint8_t flags;
+};
+
+static struct clk_cache_entry clk_cache[TEGRA194_MAX_CLK_ID];
+static bool clk_cache_filled;
+static uint32_t clk_cache_hits;
+static uint32_t clk_cache_misses;
+
+static void clk_cache_fill(void);
+
+static void clk_cache_drop_all(uint8_t flags)
+{
+	uint32_t i;
+
+	for (i = 0; i < TEGRA194_MAX_CLK_ID; i++) {
+		clk_cache[i].flags &= (uint8_t)~flags;
+	}
+}
+
+/* Returns true if ancestor is clk_id or one of its ancestors, or if that is not known */
+static bool clk_cache_descends_from(uint32_t clk_id, uint32_t ancestor)
+{
+	uint32_t depth;
+
+	for (depth = 0; depth < CLK_CACHE_MAX_DEPTH; depth++) {
+		if (clk_id == ancestor) {
+			return true;
+		}
+		if (clk_id >= TEGRA194_MAX_CLK_ID) {
+			return false;
+		}
+		if ((clk_cache[clk_id].flags & CLK_CACHE_PARENT_VALID) == 0U) {
+			return true;
+		}
+		clk_id = clk_cache[clk_id].parent;
+	}
+
+	return true;
+}
+
+/* Drop the rate of a clock and of its descendants */
+static void clk_cache_drop_rates(uint32_t clk_id)
+{
+	uint32_t i;
+
+	for (i = 0; i < TEGRA194_MAX_CLK_ID; i++) {
+		if (((clk_cache[i].flags & CLK_CACHE_RATE_VALID) != 0U) && clk_cache_descends_from(i, clk_id)) {
+			clk_cache[i].flags &= (uint8_t)~CLK_CACHE_RATE_VALID;
+		}
+	}
+}
+
+/* Drop the state of the ancestors of a clock */
+static void clk_cache_drop_ancestor_states(uint32_t clk_id)
+{
+	uint32_t depth;
+
+	for (depth = 0; depth < CLK_CACHE_MAX_DEPTH; depth++) {
+		if (clk_id >= TEGRA194_MAX_CLK_ID) {
+			return;
+		}
+		if ((clk_cache[clk_id].flags & CLK_CACHE_PARENT_VALID) == 0U) {
+			break;
+		}
+		clk_id = clk_cache[clk_id].parent;
+		if (clk_id < TEGRA194_MAX_CLK_ID) {
+			clk_cache[clk_id].flags &= (uint8_t)~CLK_CACHE_STATE_VALID;
+		}
+	}
+
+	/* Ancestry not known */
+	clk_cache_drop_all(CLK_CACHE_STATE_VALID);
+}
+
+/* Drop the clock of a module whose reset changes */
+static void clk_cache_drop_module(tegrabl_module_t module, uint8_t instance)
+{
+	int32_t clk_id = tegrabl_module_to_bpmp_id(module, instance, MOD_CLK);
+
+	if ((clk_id < 0) || ((uint32_t)clk_id >= TEGRA194_MAX_CLK_ID)) {
+		return;
+	}
+
+	clk_cache_drop_rates((uint32_t)clk_id);
+	clk_cache[clk_id].flags &= (uint8_t)~(CLK_CACHE_PARENT_VALID | CLK_CACHE_STATE_VALID);
+}
+
+static bool clk_cache_lookup(uint32_t clk_id, uint8_t flag)
+{
+	if (!clk_cache_filled) {
+		clk_cache_fill();
+	}
+
+	if ((clk_id < TEGRA194_MAX_CLK_ID) && ((clk_cache[clk_id].flags & flag) != 0U)) {
+		clk_cache_hits++;
+		return true;
+	}
+	clk_cache_misses++;
+
+	return false;
+}
+
+static void clk_cache_set_state(uint32_t clk_id, bool enabled)
+{
+	if (clk_id >= TEGRA194_MAX_CLK_ID) {
+		return;
+	}
+	clk_cache[clk_id].flags |= CLK_CACHE_STATE_VALID;
+	if (enabled) {
+		clk_cache[clk_id].flags |= CLK_CACHE_ENABLED;
+	} else {
+		clk_cache[clk_id].flags &= (uint8_t)~CLK_CACHE_ENABLED;
+	}
+}
+
+void tegrabl_car_clk_cache_invalidate(void)
+{
+	clk_cache_drop_all(CLK_CACHE_RATE_VALID | CLK_CACHE_PARENT_VALID | CLK_CACHE_STATE_VALID);
+	clk_cache_filled = false;
+}
+
+void tegrabl_car_clk_cache_stats(uint32_t *hits, uint32_t *misses)
+{
+	if (hits != NULL) {
+		*hits = clk_cache_hits;
+	}
+	if (misses != NULL) {
+		*misses = clk_cache_misses;
+	}
+}
+
+/*
+ * Deferred batch of BPMP requests.
+ *
+ * Nothing overlaps with BPMP here: there is a single CCPLEX <-> BPMP channel
+ * and tegrabl_ccplex_bpmp_xfer() blocks until BPMP answers, so each request of
+ * the batch still costs a full round trip once dispatched. The batch only lets
+ * a caller issue a series of requests and collect their status later.
+ * Requests are dispatched in order when a caller waits on them, flushes the
+ * batch, when the batch is full, or before any synchronous request of this
+ * driver, so they always reach BPMP in program order.
+ */
+#define BPMP_BATCH_DEPTH 16U
+
+struct bpmp_batch_req {
+	uint32_t mrq;
+	uint32_t req_size;
+	uint32_t resp_size;
+	union {
+		struct mrq_clk_request clk;
+		struct mrq_reset_request rst;
+		struct mrq_pg_request pg;
+		struct mrq_uphy_request uphy;
+	} req;
+	union {
+		struct mrq_clk_response clk;
+		uint32_t rst;
+	} resp;
+	tegrabl_error_t status;
+};
+
+static struct bpmp_batch_req bpmp_batch[BPMP_BATCH_DEPTH];
+/* Sequence numbers of the next request to dispatch and to add */
+static uint32_t bpmp_batch_head;
+static uint32_t bpmp_batch_tail;
+/* First error hit while dispatching, reported by the next flush */
+static tegrabl_error_t bpmp_batch_err = TEGRABL_NO_ERROR;
+
+static void bpmp_batch_dispatch_one(void)
+{
+	struct bpmp_batch_req *entry = &bpmp_batch[bpmp_batch_head % BPMP_BATCH_DEPTH];
+
+	entry->status = tegrabl_ccplex_bpmp_xfer(&entry->req,
+											 (entry->resp_size != 0U) ? &entry->resp : NULL,
+											 entry->req_size, entry->resp_size, entry->mrq);
+	if (entry->status != TEGRABL_NO_ERROR) {
+		pr_error("BPMP: deferred mrq %u failed (err=0x%x)\n", entry->mrq, entry->status);
+		if (bpmp_batch_err == TEGRABL_NO_ERROR) {
+			bpmp_batch_err = entry->status;
+		}
+	}
+	bpmp_batch_head++;
+}
+
+tegrabl_error_t tegrabl_bpmp_batch_add(const void *req, uint32_t req_size, uint32_t resp_size,
+									   uint32_t mrq, tegrabl_bpmp_handle_t *handle)
+{
+	struct bpmp_batch_req *entry;
+
+	if ((req == NULL) || (req_size > sizeof(entry->req)) || (resp_size > sizeof(entry->resp))) {
+		return TEGRABL_ERROR(TEGRABL_ERR_INVALID, 0);
+	}
+
+	/* Make room by completing the oldest request */
+	if ((bpmp_batch_tail - bpmp_batch_head) == BPMP_BATCH_DEPTH) {
+		bpmp_batch_dispatch_one();
+	}
+
+	/* The cache can't tell what a raw clock request changes */
+	if (mrq == MRQ_CLK) {
+		tegrabl_car_clk_cache_invalidate();
+	} else if (mrq == MRQ_PG) {
+		clk_cache_drop_all(CLK_CACHE_STATE_VALID);
+	}
+
+	entry = &bpmp_batch[bpmp_batch_tail % BPMP_BATCH_DEPTH];
+	memcpy(&entry->req, req, req_size);
+	entry->mrq = mrq;
+	entry->req_size = req_size;
+	entry->resp_size = resp_size;
+	entry->status = TEGRABL_NO_ERROR;
+
+	if (handle != NULL) {
+		*handle = bpmp_batch_tail;
+	}
+	bpmp_batch_tail++;
+
+	return TEGRABL_NO_ERROR;
+}
+
+tegrabl_error_t tegrabl_bpmp_batch_wait(tegrabl_bpmp_handle_t handle, void *resp)
+{
+	struct bpmp_batch_req *entry;
+
+	if (handle == TEGRABL_BPMP_HANDLE_NONE) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	/* Only the last BPMP_BATCH_DEPTH requests added still own their slot */
+	if (((bpmp_batch_tail - handle) == 0U) || ((bpmp_batch_tail - handle) > BPMP_BATCH_DEPTH)) {
+		return TEGRABL_ERROR(TEGRABL_ERR_NOT_FOUND, 0);
+	}
+
+	while ((int32_t)(handle - bpmp_batch_head) >= 0) {
+		bpmp_batch_dispatch_one();
+	}
+
+	entry = &bpmp_batch[handle % BPMP_BATCH_DEPTH];
+	if ((resp != NULL) && (entry->status == TEGRABL_NO_ERROR)) {
+		memcpy(resp, &entry->resp, entry->resp_size);
+	}
+
+	return entry->status;
+}
+
+tegrabl_error_t tegrabl_bpmp_batch_flush(void)
+{
+	tegrabl_error_t err;
+
+	while (bpmp_batch_head != bpmp_batch_tail) {
+		bpmp_batch_dispatch_one();
+	}
+
+	err = bpmp_batch_err;
+	bpmp_batch_err = TEGRABL_NO_ERROR;
+
+	return err;
+}
+
+tegrabl_error_t tegrabl_car_rst_batch_add(tegrabl_module_t module, uint8_t instance, bool assert,
+										  tegrabl_bpmp_handle_t *handle)
+{
+	struct mrq_reset_request req_rst;
+	int32_t rst_id;
+
+	/* Nothing is added for skipped resets, waiting on them succeeds at once */
+	if (handle != NULL) {
+		*handle = TEGRABL_BPMP_HANDLE_NONE;
+	}
+
+	/* XUSB resets are controlled by the PG sequence */
+	if (assert && ((module == TEGRABL_MODULE_XUSBF) || (module == TEGRABL_MODULE_XUSB_DEV) ||
+				   (module == TEGRABL_MODULE_XUSB_HOST) || (module == TEGRABL_MODULE_XUSB_SS))) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	rst_id = tegrabl_module_to_bpmp_id(module, instance, MOD_RST);
+	if (rst_id == MODULE_NOT_SUPPORTED) {
+		return TEGRABL_ERR_NOT_SUPPORTED;
+	} else if (rst_id == MODULE_NOT_SUPPORTED_SKIPPED) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	req_rst.cmd = assert ? CMD_RESET_ASSERT : CMD_RESET_DEASSERT;
+	req_rst.reset_id = (uint32_t)rst_id;
+	clk_cache_drop_module(module, instance);
+
+	return tegrabl_bpmp_batch_add(&req_rst, sizeof(req_rst), sizeof(uint32_t), MRQ_RESET, handle);
+}
+
+/* Synchronous request, ordered after everything deferred before it */
+static tegrabl_error_t clk_bpmp_xfer(void *req, void *resp, uint32_t req_size,
+									 uint32_t resp_size, uint32_t mrq)
+{
+	while (bpmp_batch_head != bpmp_batch_tail) {
+		bpmp_batch_dispatch_one();
+	}
+
+	/* Partition state changes may toggle the clocks of the partition */
+	if (mrq == MRQ_PG) {
+		clk_cache_drop_all(CLK_CACHE_STATE_VALID);
+	}
+
+	return tegrabl_ccplex_bpmp_xfer(req, resp, req_size, resp_size, mrq);
+}
+
 static tegrabl_error_t internal_tegrabl_car_set_clk_src(
 		uint32_t clk_id,
 		uint32_t clk_src)
@@ -873,7 +1019,7 @@ static tegrabl_error_t internal_tegrabl_car_set_clk_src(
 	pr_trace("(%s,%d) bpmp_src: %d\n", __func__, __LINE__, clk_src);
 
 	/* TX */
-	if (TEGRABL_NO_ERROR != tegrabl_ccplex_bpmp_xfer(
+	if (TEGRABL_NO_ERROR != clk_bpmp_xfer(
 					&req_clk_set_src, &resp_clk_set_src,
 					sizeof(struct mrq_clk_request),
 					sizeof(struct mrq_clk_response),
@@ -882,6 +1028,12 @@ static tegrabl_error_t internal_tegrabl_car_set_clk_src(
 		return TEGRABL_ERR_INVALID;
 	}
 
+	clk_cache_drop_rates(clk_id);
+	if (clk_id < TEGRA194_MAX_CLK_ID) {
+		clk_cache[clk_id].parent = (uint16_t)clk_src;
+		clk_cache[clk_id].flags |= CLK_CACHE_PARENT_VALID;
+	}
+
 	return TEGRABL_NO_ERROR;
 }
 
@@ -896,10 +1048,15 @@ static tegrabl_error_t internal_tegrabl_car_get_clk_rate(
 		return TEGRABL_ERR_NOT_SUPPORTED;
 	}
 
+	if (clk_cache_lookup(clk_id, CLK_CACHE_RATE_VALID)) {
+		*rate_khz = clk_cache[clk_id].rate_khz;
+		return TEGRABL_NO_ERROR;
+	}
+
 	req_clk_get_rate.cmd_and_id = BPMP_CLK_CMD(CMD_CLK_GET_RATE, clk_id);
 
 	/* TX */
-	if (TEGRABL_NO_ERROR != tegrabl_ccplex_bpmp_xfer(
+	if (TEGRABL_NO_ERROR != clk_bpmp_xfer(
 					&req_clk_get_rate, &resp_clk_get_rate,
 					sizeof(struct mrq_clk_request),
 					sizeof(struct mrq_clk_response),
@@ -912,6 +1069,11 @@ static tegrabl_error_t internal_tegrabl_car_get_clk_rate(
 	*rate_khz = (resp_clk_get_rate.clk_get_rate.rate)/HZ_1K;
 	pr_trace("Received data (from BPMP) %d\n", *rate_khz);
 
+	if (clk_id < TEGRA194_MAX_CLK_ID) {
+		clk_cache[clk_id].rate_khz = *rate_khz;
+		clk_cache[clk_id].flags |= CLK_CACHE_RATE_VALID;
+	}
+
 	return TEGRABL_NO_ERROR;
 }
 
@@ -931,7 +1093,7 @@ static tegrabl_error_t internal_tegrabl_car_set_clk_rate(
 	req_clk_set_rate.clk_set_rate.rate = rate_khz*HZ_1K;
 
 	/* TX */
-	if (TEGRABL_NO_ERROR != tegrabl_ccplex_bpmp_xfer(
+	if (TEGRABL_NO_ERROR != clk_bpmp_xfer(
 					&req_clk_set_rate, &resp_clk_set_rate,
 					sizeof(struct mrq_clk_request),
 					sizeof(struct mrq_clk_response),
@@ -943,6 +1105,12 @@ static tegrabl_error_t internal_tegrabl_car_set_clk_rate(
 	/* RX */
 	*rate_set_khz = (resp_clk_set_rate.clk_set_rate.rate)/HZ_1K;
 
+	clk_cache_drop_rates(clk_id);
+	if (clk_id < TEGRA194_MAX_CLK_ID) {
+		clk_cache[clk_id].rate_khz = *rate_set_khz;
+		clk_cache[clk_id].flags |= CLK_CACHE_RATE_VALID;
+	}
+
 	pr_trace("(%s,%d) Enabled rate %d for %d\n", __func__, __LINE__,
 			 *rate_set_khz, clk_id);
 
@@ -964,7 +1132,7 @@ static tegrabl_error_t internal_tegrabl_car_clk_enable(uint32_t clk_id)
 	req_clk_enable.cmd_and_id = BPMP_CLK_CMD(CMD_CLK_ENABLE, clk_id);
 
 	/* TX */
-	if (TEGRABL_NO_ERROR != tegrabl_ccplex_bpmp_xfer(
+	if (TEGRABL_NO_ERROR != clk_bpmp_xfer(
 					&req_clk_enable, &resp_clk_enable,
 					sizeof(struct mrq_clk_request),
 					sizeof(struct mrq_clk_response),
@@ -975,34 +1143,56 @@ static tegrabl_error_t internal_tegrabl_car_clk_enable(uint32_t clk_id)
 
 	pr_trace("(%s,%d) Enabled - %d\n", __func__, __LINE__, clk_id);
 
+	clk_cache_drop_ancestor_states(clk_id);
+	clk_cache_set_state(clk_id, true);
+
 		return TEGRABL_NO_ERROR;
 }
 
-static bool internal_tegrabl_car_clk_is_enabled(uint32_t clk_id)
+static tegrabl_error_t internal_tegrabl_car_get_clk_state(uint32_t clk_id, bool *enabled)
 {
 	struct mrq_clk_request req_clk_is_enabled;
 	struct mrq_clk_response resp_clk_is_enabled;
 
 	if (clk_id == MODULE_NOT_SUPPORTED) {
-		return false;
+		return TEGRABL_ERR_NOT_SUPPORTED;
+	}
+
+	if (clk_cache_lookup(clk_id, CLK_CACHE_STATE_VALID)) {
+		*enabled = (clk_cache[clk_id].flags & CLK_CACHE_ENABLED) != 0U;
+		return TEGRABL_NO_ERROR;
 	}
 
 	req_clk_is_enabled.cmd_and_id = BPMP_CLK_CMD(CMD_CLK_IS_ENABLED, clk_id);
 
 	/* TX */
-	if (TEGRABL_NO_ERROR != tegrabl_ccplex_bpmp_xfer(
+	if (TEGRABL_NO_ERROR != clk_bpmp_xfer(
 					&req_clk_is_enabled, &resp_clk_is_enabled,
 					sizeof(struct mrq_clk_request),
 					sizeof(struct mrq_clk_response),
 					MRQ_CLK)) {
 		pr_error("Error in tx-rx: %s,%d\n", __func__, __LINE__);
-		return false;
+		return TEGRABL_ERR_INVALID;
 	}
 
 	pr_trace("(%s,%d) clk(%d) state = %d\n", __func__, __LINE__, clk_id,
 			 resp_clk_is_enabled.clk_is_enabled.state);
 
-	return (bool)resp_clk_is_enabled.clk_is_enabled.state;
+	clk_cache_set_state(clk_id, resp_clk_is_enabled.clk_is_enabled.state != 0);
+	*enabled = resp_clk_is_enabled.clk_is_enabled.state != 0;
+
+	return TEGRABL_NO_ERROR;
+}
+
+static bool internal_tegrabl_car_clk_is_enabled(uint32_t clk_id)
+{
+	bool enabled = false;
+
+	if (internal_tegrabl_car_get_clk_state(clk_id, &enabled) != TEGRABL_NO_ERROR) {
+		return false;
+	}
+
+	return enabled;
 }
 
 bool tegrabl_car_clk_is_enabled(tegrabl_module_t module, uint8_t instance)
@@ -1039,7 +1229,7 @@ static tegrabl_error_t internal_tegrabl_car_clk_disable(uint32_t clk_id)
 	req_clk_disable.cmd_and_id = BPMP_CLK_CMD(CMD_CLK_DISABLE, clk_id);
 
 	/* TX */
-	if (TEGRABL_NO_ERROR != tegrabl_ccplex_bpmp_xfer(
+	if (TEGRABL_NO_ERROR != clk_bpmp_xfer(
 					&req_clk_disable, &resp_clk_disable,
 					sizeof(struct mrq_clk_request),
 					sizeof(struct mrq_clk_response),
@@ -1050,6 +1240,9 @@ static tegrabl_error_t internal_tegrabl_car_clk_disable(uint32_t clk_id)
 
 	pr_trace("(%s,%d) Disabled - %d\n", __func__, __LINE__, clk_id);
 
+	clk_cache_drop_ancestor_states(clk_id);
+	clk_cache_set_state(clk_id, false);
+
 		return TEGRABL_NO_ERROR;
 }
 
@@ -1070,7 +1263,7 @@ static tegrabl_error_t internal_tegrabl_car_rst(uint32_t rst_id, uint32_t flag)
 	req_rst.reset_id = rst_id;
 
 	/* TX */
-	if (TEGRABL_NO_ERROR != tegrabl_ccplex_bpmp_xfer(
+	if (TEGRABL_NO_ERROR != clk_bpmp_xfer(
 					&req_rst, &resp_rst,
 					sizeof(req_rst),
 					sizeof(resp_rst),
@@ -1081,6 +1274,81 @@ static tegrabl_error_t internal_tegrabl_car_rst(uint32_t rst_id, uint32_t flag)
 	return TEGRABL_NO_ERROR;
 }
 
+static tegrabl_error_t internal_tegrabl_car_get_clk_parent(
+		uint32_t clk_id,
+		uint32_t *parent_id)
+{
+	struct mrq_clk_request req_clk_get_src;
+	struct mrq_clk_response resp_clk_get_src;
+
+	if (clk_cache_lookup(clk_id, CLK_CACHE_PARENT_VALID)) {
+		*parent_id = clk_cache[clk_id].parent;
+		return TEGRABL_NO_ERROR;
+	}
+
+	req_clk_get_src.cmd_and_id = BPMP_CLK_CMD(CMD_CLK_GET_PARENT, clk_id);
+
+	/* TX */
+	if (TEGRABL_NO_ERROR != clk_bpmp_xfer(
+					&req_clk_get_src, &resp_clk_get_src,
+					sizeof(struct mrq_clk_request),
+					sizeof(struct mrq_clk_response),
+					MRQ_CLK)) {
+		pr_error("Error in tx-rx: %s,%d\n", __func__, __LINE__);
+		return TEGRABL_ERR_INVALID;
+	}
+
+	/* RX */
+	*parent_id = resp_clk_get_src.clk_get_parent.parent_id;
+	pr_trace("Received parent_id (from BPMP): %d\n", *parent_id);
+
+	if (clk_id < TEGRA194_MAX_CLK_ID) {
+		clk_cache[clk_id].parent = (uint16_t)*parent_id;
+		clk_cache[clk_id].flags |= CLK_CACHE_PARENT_VALID;
+	}
+
+	return TEGRABL_NO_ERROR;
+}
+
+/*
+ * Read the state, rate and parent of the clocks of the module mapping, and the
+ * parents of their ancestors, in one pass. MRQ_CLK has no multi-clock query,
+ * each field costs one transaction, but they are all issued here at once
+ * instead of on the lookups spread over the boot.
+ */
+static void clk_cache_fill(void)
+{
+	uint32_t map[CLK_MAP_WORDS] = { 0 };
+	uint32_t clk_id;
+	uint32_t cur;
+	uint32_t value;
+	uint32_t depth;
+	bool enabled;
+
+	/* Lookups of the pass itself go to BPMP */
+	clk_cache_filled = true;
+
+	clk_map_mark_modules(map);
+	for (clk_id = 0; clk_id < TEGRA194_MAX_CLK_ID; clk_id++) {
+		if (!clk_map_is_marked(map, clk_id)) {
+			continue;
+		}
+		(void)internal_tegrabl_car_get_clk_state(clk_id, &enabled);
+		(void)internal_tegrabl_car_get_clk_rate(clk_id, &value);
+
+		for (cur = clk_id, depth = 0; (cur < TEGRA194_MAX_CLK_ID) && (depth < CLK_CACHE_MAX_DEPTH) &&
+			 ((clk_cache[cur].flags & CLK_CACHE_PARENT_VALID) == 0U); depth++) {
+			if (internal_tegrabl_car_get_clk_parent(cur, &value) != TEGRABL_NO_ERROR) {
+				/* Root clock */
+				clk_cache[cur].parent = CLK_CACHE_NO_PARENT;
+				clk_cache[cur].flags |= CLK_CACHE_PARENT_VALID;
+				break;
+			}
+			cur = value;
+		}
+	}
+}
+
 /**
  * ------------------------NOTES------------------------
  * Please read below before using these APIs.
@@ -1103,9 +1371,8 @@ tegrabl_clk_src_id_t tegrabl_car_get_clk_src(
 		tegrabl_module_t module,
 		uint8_t instance)
 {
-	struct mrq_clk_request req_clk_get_src;
-	struct mrq_clk_response resp_clk_get_src;
 	int32_t clk_id;
+	uint32_t parent_id;
 
 	pr_trace("(%s,%d) %d, %d\n", __func__, __LINE__,
 			 module, instance);
@@ -1115,23 +1382,11 @@ tegrabl_clk_src_id_t tegrabl_car_get_clk_src(
 		return TEGRABL_ERR_NOT_SUPPORTED;
 	}
 
-	req_clk_get_src.cmd_and_id = BPMP_CLK_CMD(CMD_CLK_GET_PARENT, clk_id);
-
-	/* TX */
-	if (TEGRABL_NO_ERROR != tegrabl_ccplex_bpmp_xfer(
-					&req_clk_get_src, &resp_clk_get_src,
-					sizeof(struct mrq_clk_request),
-					sizeof(struct mrq_clk_response),
-					MRQ_CLK)) {
-		pr_error("Error in tx-rx: %s,%d\n", __func__, __LINE__);
+	if (internal_tegrabl_car_get_clk_parent((uint32_t)clk_id, &parent_id) != TEGRABL_NO_ERROR) {
 		return TEGRABL_CLK_SRC_INVALID;
 	}
 
-	/* RX */
-	pr_trace("Received parent_id (from BPMP): %d\n",
-			 resp_clk_get_src.clk_get_parent.parent_id);
-
-	return src_clk_bpmp_to_tegrabl(resp_clk_get_src.clk_get_parent.parent_id);
+	return src_clk_bpmp_to_tegrabl(parent_id);
 }
 
 /**
@@ -1267,7 +1522,8 @@ tegrabl_error_t tegrabl_car_set_clk_rate(
  */
 void tegrabl_car_clock_init(void)
 {
-	/* Since BPMP takes care of initializing clk, hence this init is empty */
+	/* Since BPMP takes care of initializing clk, only the shadow state is reset */
+	tegrabl_car_clk_cache_invalidate();
 	return;
 }
 
@@ -1554,6 +1810,8 @@ tegrabl_error_t tegrabl_car_rst_set(tegrabl_module_t module,
 		break;
 	}
 
+	clk_cache_drop_module(module, instance);
+
 	return internal_tegrabl_car_rst(
 				tegrabl_module_to_bpmp_id(module, instance, MOD_RST),
 				CMD_RESET_ASSERT);
@@ -1572,6 +1830,8 @@ tegrabl_error_t tegrabl_car_rst_clear(tegrabl_module_t module,
 	pr_trace("(%s,%d) %d, %d\n", __func__, __LINE__,
 			 module, instance);
 
+	clk_cache_drop_module(module, instance);
+
 	return internal_tegrabl_car_rst(
 				tegrabl_module_to_bpmp_id(module, instance, MOD_RST),
 				CMD_RESET_DEASSERT);
@@ -1615,6 +1875,9 @@ void tegrabl_usbf_program_tracking_clock(bool is_enable)
 	return;
 }
 
+/* XUSB partitions are held by the USB clock init */
+static bool xusb_pg_held;
+
 tegrabl_error_t tegrabl_usbf_clock_init(void)
 {
 	uint32_t dummy;
@@ -1632,14 +1895,7 @@ tegrabl_error_t tegrabl_usbf_clock_init(void)
 	const uint8_t clk_id = 0;
 	const uint8_t src_id = 1;
 	const uint8_t rate = 2;
-
-	struct mrq_pg_request xusb_pg_request = {
-		.cmd = CMD_PG_SET_STATE,
-		.id = TEGRA194_POWER_DOMAIN_XUSBA,
-		.set_state = {
-			.state = PG_STATE_ON,
-		}
-	};
+	uint32_t domain_id;
 
 	pr_trace("Programming XUSB clks\n");
 	for (index = 0UL; index < 3UL; index++) {
@@ -1653,19 +1909,22 @@ tegrabl_error_t tegrabl_usbf_clock_init(void)
 		}
 	}
 
-	/* unPowerGate XUSB */
-	while (xusb_pg_request.id <= TEGRA194_POWER_DOMAIN_XUSBC) {
-		err = tegrabl_ccplex_bpmp_xfer(&xusb_pg_request, NULL, sizeof(xusb_pg_request), 0, MRQ_PG);
+	/* unPowerGate XUSB, XUSBA is brought up before XUSBB and XUSBC */
+	if (!xusb_pg_held) {
+		tegrabl_pg_batch_begin();
+		for (domain_id = TEGRA194_POWER_DOMAIN_XUSBA; domain_id <= TEGRA194_POWER_DOMAIN_XUSBC; domain_id++) {
+			(void)tegrabl_pg_get(domain_id);
+		}
+		err = tegrabl_pg_batch_commit();
 		if (err != TEGRABL_NO_ERROR) {
-			pr_error("PG_STATE_ON for %d failed. Skipping others.\n", xusb_pg_request.id);
-			TEGRABL_SET_HIGHEST_MODULE(err);
+			pr_error("PG_STATE_ON for XUSB partitions failed\n");
+			for (domain_id = TEGRA194_POWER_DOMAIN_XUSBA; domain_id <= TEGRA194_POWER_DOMAIN_XUSBC; domain_id++) {
+				(void)tegrabl_pg_put(domain_id);
+			}
 			goto fail;
-		} else {
-			pr_trace("un-Powergated %d\n", xusb_pg_request.id);
 		}
-		++(xusb_pg_request.id);
+		xusb_pg_held = true;
 	}
-	err = TEGRABL_NO_ERROR;
 
 fail:
 	return err;
@@ -1674,30 +1933,20 @@ fail:
 tegrabl_error_t tegrabl_usb_powergate(void)
 {
 	tegrabl_error_t err = TEGRABL_NO_ERROR;
+	uint32_t domain_id;
 
-	struct mrq_pg_request xusb_pg_request = {
-		.cmd = CMD_PG_SET_STATE,
-		.id = TEGRA194_POWER_DOMAIN_XUSBA,
-		.set_state = {
-			.state = PG_STATE_OFF,
-		}
-	};
-
-	/* PowerGate XUSBA and XUSBC partitions */
-	while (xusb_pg_request.id <= TEGRA194_POWER_DOMAIN_XUSBC) {
-		err = tegrabl_ccplex_bpmp_xfer(&xusb_pg_request, NULL, sizeof(xusb_pg_request), 0, MRQ_PG);
-		if (err != TEGRABL_NO_ERROR) {
-			pr_error("PG_STATE_OFF for %d failed. Skipping others.\n", xusb_pg_request.id);
-			TEGRABL_SET_HIGHEST_MODULE(err);
-			goto fail;
-		} else {
-			pr_trace("Powergated %d\n", xusb_pg_request.id);
-		}
-		++(xusb_pg_request.id);
+	/* PowerGate XUSB partitions, XUSBA goes down after XUSBB and XUSBC. Without the
+	 * references of the USB clock init, puts force the partitions off. */
+	tegrabl_pg_batch_begin();
+	for (domain_id = TEGRA194_POWER_DOMAIN_XUSBA; domain_id <= TEGRA194_POWER_DOMAIN_XUSBC; domain_id++) {
+		(void)tegrabl_pg_put(domain_id);
+	}
+	xusb_pg_held = false;
+	err = tegrabl_pg_batch_commit();
+	if (err != TEGRABL_NO_ERROR) {
+		pr_error("PG_STATE_OFF for XUSB partitions failed\n");
 	}
-	err = TEGRABL_NO_ERROR;
 
-fail:
 	return err;
 }
 
@@ -1852,68 +2101,225 @@ tegrabl_error_t tegrabl_clk_pll_hw_sequencer_disable(tegrabl_clk_pll_id_t pll_id
 	return internal_tegrabl_clk_pll_hw_sequencer_state(pll_id, false);
 }
 
-tegrabl_error_t tegrabl_pcie_unpowergate(uint32_t domain_id)
+/*
+ * Power partition manager. Users take and drop references on partitions, and
+ * BPMP is only asked to change a partition when it gets its first reference
+ * or loses its last one. A powered partition holds a reference on the
+ * partition it depends on, which is so powered on first and off last.
+ */
+#define PG_DOMAIN_UNKNOWN	0U
+#define PG_DOMAIN_ON		1U
+#define PG_DOMAIN_OFF		2U
+
+struct pg_domain {
+	uint8_t refcount;
+	uint8_t state;
+	/* Put without reference, partition is to be turned off if it may be on */
+	bool off_pending;
+};
+
+static struct pg_domain pg_domains[TEGRA194_POWER_DOMAIN_MAX + 1];
+
+/* Partition each partition depends on, 0 if none */
+static const uint8_t pg_domain_parent[TEGRA194_POWER_DOMAIN_MAX + 1] = {
+	[TEGRA194_POWER_DOMAIN_DISPB] = TEGRA194_POWER_DOMAIN_DISP,
+	[TEGRA194_POWER_DOMAIN_DISPC] = TEGRA194_POWER_DOMAIN_DISP,
+	[TEGRA194_POWER_DOMAIN_XUSBB] = TEGRA194_POWER_DOMAIN_XUSBA,
+	[TEGRA194_POWER_DOMAIN_XUSBC] = TEGRA194_POWER_DOMAIN_XUSBA,
+};
+
+static uint32_t pg_batch_depth;
+
+/* UPHY ownership last requested for each PCIe controller, see tegrabl_set_ctrl_state */
+static uint8_t ctrl_state_known;
+static uint8_t ctrl_state_enabled;
+
+/* A controller loses its UPHY ownership state along with its partition */
+static void pg_domain_drop_ctrl_state(uint32_t domain_id)
 {
-	tegrabl_error_t err = TEGRABL_NO_ERROR;
+	uint8_t ctrl_num;
 
-	struct mrq_pg_request pg_request = {
-		.cmd = CMD_PG_SET_STATE,
-		.id = domain_id,
-		.set_state = {
-			.state = PG_STATE_ON,
+	for (ctrl_num = 0; ctrl_num < 5U; ctrl_num++) {
+		if (tegrabl_car_get_pg_id(TEGRABL_MODULE_PCIE_CORE, ctrl_num) == domain_id) {
+			ctrl_state_known &= (uint8_t)~(1U << ctrl_num);
 		}
-	};
+	}
+}
 
-	if (domain_id <= TEGRA194_POWER_DOMAIN_MAX) {
-		err = tegrabl_ccplex_bpmp_xfer(&pg_request, NULL, sizeof(pg_request), 0, MRQ_PG);
-		if (err != TEGRABL_NO_ERROR) {
-			pr_error("BPMP: PG_STATE_ON for %d failed\n", pg_request.id);
-			TEGRABL_SET_HIGHEST_MODULE(err);
-			goto fail;
-		} else {
-			pr_trace("BPMP: UnPowergated %d\n", pg_request.id);
+static void pg_domain_ref(uint32_t domain_id)
+{
+	while (domain_id != 0U) {
+		if (pg_domains[domain_id].refcount++ != 0U) {
+			break;
 		}
-	} else {
-		err = TEGRABL_ERR_INVALID;
+		domain_id = pg_domain_parent[domain_id];
 	}
-
-fail:
-	return err;
 }
 
-tegrabl_error_t tegrabl_pcie_powergate(uint32_t domain_id)
+static void pg_domain_unref(uint32_t domain_id)
 {
-	tegrabl_error_t err = TEGRABL_NO_ERROR;
+	while (domain_id != 0U) {
+		if (pg_domains[domain_id].refcount == 0U) {
+			pg_domains[domain_id].off_pending = true;
+			break;
+		}
+		if (--pg_domains[domain_id].refcount != 0U) {
+			break;
+		}
+		domain_id = pg_domain_parent[domain_id];
+	}
+}
 
+static tegrabl_error_t pg_domain_set_state(uint32_t domain_id, bool on)
+{
+	tegrabl_error_t err;
 	struct mrq_pg_request pg_request = {
 		.cmd = CMD_PG_SET_STATE,
 		.id = domain_id,
 		.set_state = {
-			.state = PG_STATE_OFF,
+			.state = on ? PG_STATE_ON : PG_STATE_OFF,
 		}
 	};
 
-	if (domain_id <= TEGRA194_POWER_DOMAIN_MAX) {
-		err = tegrabl_ccplex_bpmp_xfer(&pg_request, NULL, sizeof(pg_request), 0, MRQ_PG);
-		if (err != TEGRABL_NO_ERROR) {
-			pr_error("BPMP: PG_STATE_OFF for %d failed\n", pg_request.id);
-			TEGRABL_SET_HIGHEST_MODULE(err);
-			goto fail;
-		} else {
-			pr_trace("BPMP: Powergated %d\n", pg_request.id);
+	pg_domain_drop_ctrl_state(domain_id);
+
+	err = clk_bpmp_xfer(&pg_request, NULL, sizeof(pg_request), 0, MRQ_PG);
+	if (err != TEGRABL_NO_ERROR) {
+		pr_error("BPMP: PG_STATE_%s for %d failed\n", on ? "ON" : "OFF", pg_request.id);
+		TEGRABL_SET_HIGHEST_MODULE(err);
+		pg_domains[domain_id].state = PG_DOMAIN_UNKNOWN;
+		return err;
+	}
+
+	pr_trace("BPMP: %s %d\n", on ? "UnPowergated" : "Powergated", pg_request.id);
+	pg_domains[domain_id].state = on ? PG_DOMAIN_ON : PG_DOMAIN_OFF;
+
+	return TEGRABL_NO_ERROR;
+}
+
+/* Bring all the partitions to the state their references ask for */
+static tegrabl_error_t pg_domains_commit(void)
+{
+	tegrabl_error_t status = TEGRABL_NO_ERROR;
+	tegrabl_error_t err;
+	struct pg_domain *domain;
+	uint32_t pass;
+	uint32_t id;
+
+	/* Dependencies first when powering on */
+	for (pass = 0; pass < 2U; pass++) {
+		for (id = 1; id <= TEGRA194_POWER_DOMAIN_MAX; id++) {
+			domain = &pg_domains[id];
+			if (((pg_domain_parent[id] != 0U) != (pass != 0U)) ||
+				(domain->refcount == 0U) || (domain->state == PG_DOMAIN_ON)) {
+				continue;
+			}
+			domain->off_pending = false;
+			err = pg_domain_set_state(id, true);
+			if ((err != TEGRABL_NO_ERROR) && (status == TEGRABL_NO_ERROR)) {
+				status = err;
+			}
 		}
-	} else {
-		err = TEGRABL_ERR_INVALID;
 	}
 
-fail:
+	/* Dependencies last when powering off */
+	for (pass = 0; pass < 2U; pass++) {
+		for (id = 1; id <= TEGRA194_POWER_DOMAIN_MAX; id++) {
+			domain = &pg_domains[id];
+			if (((pg_domain_parent[id] != 0U) == (pass != 0U)) || (domain->refcount != 0U) ||
+				((domain->state != PG_DOMAIN_ON) && !domain->off_pending)) {
+				continue;
+			}
+			domain->off_pending = false;
+			err = pg_domain_set_state(id, false);
+			if ((err != TEGRABL_NO_ERROR) && (status == TEGRABL_NO_ERROR)) {
+				status = err;
+			}
+		}
+	}
+
+	return status;
+}
+
+void tegrabl_pg_batch_begin(void)
+{
+	pg_batch_depth++;
+}
+
+tegrabl_error_t tegrabl_pg_batch_commit(void)
+{
+	if (pg_batch_depth == 0U) {
+		return TEGRABL_ERROR(TEGRABL_ERR_INVALID, 1);
+	}
+
+	pg_batch_depth--;
+	if (pg_batch_depth != 0U) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	return pg_domains_commit();
+}
+
+tegrabl_error_t tegrabl_pg_get(uint32_t domain_id)
+{
+	tegrabl_error_t err;
+
+	if ((domain_id == 0U) || (domain_id > TEGRA194_POWER_DOMAIN_MAX)) {
+		return TEGRABL_ERR_INVALID;
+	}
+
+	pg_domain_ref(domain_id);
+	if (pg_batch_depth != 0U) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	err = pg_domains_commit();
+	if ((err != TEGRABL_NO_ERROR) && (pg_domains[domain_id].state != PG_DOMAIN_ON)) {
+		/* Drop the reference which could not be honoured, along with the
+		 * partitions it powered on */
+		pg_domain_unref(domain_id);
+		(void)pg_domains_commit();
+	}
+
 	return err;
 }
 
+tegrabl_error_t tegrabl_pg_put(uint32_t domain_id)
+{
+	if ((domain_id == 0U) || (domain_id > TEGRA194_POWER_DOMAIN_MAX)) {
+		return TEGRABL_ERR_INVALID;
+	}
+
+	pg_domain_unref(domain_id);
+	if (pg_batch_depth != 0U) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	return pg_domains_commit();
+}
+
+uint32_t tegrabl_pg_refcount(uint32_t domain_id)
+{
+	if ((domain_id == 0U) || (domain_id > TEGRA194_POWER_DOMAIN_MAX)) {
+		return 0;
+	}
+
+	return pg_domains[domain_id].refcount;
+}
+
+tegrabl_error_t tegrabl_pcie_unpowergate(uint32_t domain_id)
+{
+	return tegrabl_pg_get(domain_id);
+}
+
+tegrabl_error_t tegrabl_pcie_powergate(uint32_t domain_id)
+{
+	return tegrabl_pg_put(domain_id);
+}
+
 tegrabl_error_t tegrabl_set_ctrl_state(uint8_t ctrl_num, bool enable)
 {
 	tegrabl_error_t err = TEGRABL_NO_ERROR;
-
 	struct mrq_uphy_request uphy_request = {
 		.cmd = CMD_UPHY_PCIE_CONTROLLER_STATE,
 		.controller_state = {
@@ -1928,13 +2334,25 @@ tegrabl_error_t tegrabl_set_ctrl_state(uint8_t ctrl_num, bool enable)
 	}
 
 	if (ctrl_num < 5) {
-		err = tegrabl_ccplex_bpmp_xfer(&uphy_request, NULL, sizeof(uphy_request), 0, MRQ_UPHY);
+		if (((ctrl_state_known & (1U << ctrl_num)) != 0U) &&
+			(((ctrl_state_enabled & (1U << ctrl_num)) != 0U) == enable)) {
+			pr_trace("BPMP: set_ctrl_state %d unchanged\n", ctrl_num);
+			return TEGRABL_NO_ERROR;
+		}
+		err = clk_bpmp_xfer(&uphy_request, NULL, sizeof(uphy_request), 0, MRQ_UPHY);
 		if (err != TEGRABL_NO_ERROR) {
 			pr_error("BPMP: set_ctrl_state for %d failed\n", ctrl_num);
+			ctrl_state_known &= (uint8_t)~(1U << ctrl_num);
 			TEGRABL_SET_HIGHEST_MODULE(err);
 			goto fail;
 		} else {
 			pr_trace("BPMP: set_ctrl_state %d\n", ctrl_num);
+			ctrl_state_known |= (uint8_t)(1U << ctrl_num);
+			if (enable) {
+				ctrl_state_enabled |= (uint8_t)(1U << ctrl_num);
+			} else {
+				ctrl_state_enabled &= (uint8_t)~(1U << ctrl_num);
+			}
 		}
 	} else {
 		err = TEGRABL_ERR_INVALID;
@@ -1943,3 +2361,121 @@ tegrabl_error_t tegrabl_set_ctrl_state(uint8_t ctrl_num, bool enable)
 fail:
 	return err;
 }
+
+#if defined(CONFIG_ENABLE_CLK_SNAPSHOT)
+tegrabl_error_t tegrabl_clk_snapshot(struct tegrabl_clk_snapshot_entry *entries, uint32_t max_entries,
+									 uint32_t *num_entries)
+{
+	uint32_t map[CLK_MAP_WORDS] = { 0 };
+	struct tegrabl_clk_snapshot_entry *entry;
+	uint32_t clk_id;
+	uint32_t value;
+	uint32_t count = 0;
+	bool enabled;
+
+	if ((entries == NULL) || (num_entries == NULL)) {
+		return TEGRABL_ERROR(TEGRABL_ERR_INVALID, 0);
+	}
+
+	/* Report what BPMP has, not what the shadow state assumes */
+	tegrabl_car_clk_cache_invalidate();
+
+	clk_map_mark_modules(map);
+
+	/*
+	 * MRQ_CLK has no multi-clock query, each field costs one transaction.
+	 * Entries are sorted by clock id so that snapshots of different boots can
+	 * be diffed directly.
+	 */
+	for (clk_id = 0; clk_id < TEGRA194_MAX_CLK_ID; clk_id++) {
+		if (!clk_map_is_marked(map, clk_id)) {
+			continue;
+		}
+		if (count == max_entries) {
+			pr_error("%s: more than %u clocks\n", __func__, max_entries);
+			*num_entries = count;
+			return TEGRABL_ERROR(TEGRABL_ERR_TOO_SMALL, 0);
+		}
+
+		entry = &entries[count++];
+		entry->clk_id = (uint16_t)clk_id;
+		if (internal_tegrabl_car_get_clk_state(clk_id, &enabled) == TEGRABL_NO_ERROR) {
+			entry->enabled = enabled ? 1U : 0U;
+		} else {
+			entry->enabled = TEGRABL_CLK_SNAPSHOT_STATE_UNKNOWN;
+		}
+
+		if (internal_tegrabl_car_get_clk_parent(clk_id, &value) == TEGRABL_NO_ERROR) {
+			entry->parent_id = (uint16_t)value;
+		} else {
+			entry->parent_id = TEGRABL_CLK_SNAPSHOT_NO_PARENT;
+		}
+
+		if (internal_tegrabl_car_get_clk_rate(clk_id, &value) == TEGRABL_NO_ERROR) {
+			entry->rate_khz = value;
+		} else {
+			entry->rate_khz = 0;
+		}
+	}
+
+	*num_entries = count;
+
+	return TEGRABL_NO_ERROR;
+}
+
+void tegrabl_clk_snapshot_dump(const struct tegrabl_clk_snapshot_entry *entries, uint32_t num_entries)
+{
+	const char *state;
+	uint32_t i;
+
+	pr_info("Clock snapshot (%u clocks):\n", num_entries);
+	for (i = 0; i < num_entries; i++) {
+		if (entries[i].enabled == TEGRABL_CLK_SNAPSHOT_STATE_UNKNOWN) {
+			state = "???";
+		} else {
+			state = (entries[i].enabled != 0U) ? "on " : "off";
+		}
+		pr_info("  clk %3u: %s parent %3u rate %u kHz\n", entries[i].clk_id, state, entries[i].parent_id,
+				entries[i].rate_khz);
+	}
+}
+
+tegrabl_error_t tegrabl_clk_snapshot_add_to_dt(void *fdt, int32_t nodeoffset,
+											   const struct tegrabl_clk_snapshot_entry *entries,
+											   uint32_t num_entries)
+{
+	uint32_t *cells;
+	uint32_t i;
+	int err;
+	tegrabl_error_t status = TEGRABL_NO_ERROR;
+
+	if ((fdt == NULL) || (entries == NULL) || (num_entries == 0U)) {
+		return TEGRABL_ERROR(TEGRABL_ERR_INVALID, 1);
+	}
+
+	cells = tegrabl_malloc(num_entries * 3U * sizeof(uint32_t));
+	if (cells == NULL) {
+		return TEGRABL_ERROR(TEGRABL_ERR_NO_MEMORY, 0);
+	}
+
+	/* <id | enabled << 31 | unknown << 30, parent, rate in kHz> per clock */
+	for (i = 0; i < num_entries; i++) {
+		if (entries[i].enabled == TEGRABL_CLK_SNAPSHOT_STATE_UNKNOWN) {
+			cells[3U * i] = cpu_to_fdt32((uint32_t)entries[i].clk_id | (1UL << 30));
+		} else {
+			cells[3U * i] = cpu_to_fdt32((uint32_t)entries[i].clk_id | ((uint32_t)entries[i].enabled << 31));
+		}
+		cells[(3U * i) + 1U] = cpu_to_fdt32(entries[i].parent_id);
+		cells[(3U * i) + 2U] = cpu_to_fdt32(entries[i].rate_khz);
+	}
+
+	err = fdt_setprop(fdt, nodeoffset, "nvidia,bl-clk-snapshot", cells, num_entries * 3U * sizeof(uint32_t));
+	if (err < 0) {
+		pr_error("Failed to add clock snapshot to DT (%s)\n", fdt_strerror(err));
+		status = TEGRABL_ERROR(TEGRABL_ERR_ADD_FAILED, 0);
+	}
+
+	tegrabl_free(cells);
+	return status;
+}
+#endif /* CONFIG_ENABLE_CLK_SNAPSHOT */
@@ -16,50 +16,53 @@
 #include <powergate-t194.h>
 #include <tegrabl_i2c.h>
 #include <tegrabl_error.h>
+#include <tegrabl_clock.h>
+#include <tegrabl_soc_clock.h>
+
+/* Display partitions are held between unpowergate and powergate */
+static bool disp_pg_held;
 
 void tegrabl_display_unpowergate(void)
 {
-	struct mrq_pg_request disp_pg_request = {
-		.cmd = CMD_PG_SET_STATE,
-		.id = TEGRA194_POWER_DOMAIN_DISP,
-		.set_state = {
-			.state = PG_STATE_ON,
-		}
-	};
+	uint32_t domain_id;
 
-	while (disp_pg_request.id <= TEGRA194_POWER_DOMAIN_DISPC) {
-		if (tegrabl_ccplex_bpmp_xfer(&disp_pg_request, NULL, sizeof(disp_pg_request),
-				0, MRQ_PG) != TEGRABL_NO_ERROR) {
-			pr_error("%s: Unable to power on - TEGRA194_POWER_DOMAIN_DISP%c\n",
-					 __func__, disp_pg_request.id - TEGRA194_POWER_DOMAIN_DISP == 0 ?
-					 ' ' : disp_pg_request.id - TEGRA194_POWER_DOMAIN_DISP + 'A');
-		}
+	if (disp_pg_held) {
+		return;
+	}
 
-		(disp_pg_request.id)++;
+	/* DISP is powered on before DISPB and DISPC */
+	tegrabl_pg_batch_begin();
+	for (domain_id = TEGRA194_POWER_DOMAIN_DISP; domain_id <= TEGRA194_POWER_DOMAIN_DISPC; domain_id++) {
+		(void)tegrabl_pg_get(domain_id);
+	}
+	if (tegrabl_pg_batch_commit() != TEGRABL_NO_ERROR) {
+		pr_error("%s: Unable to power on display partitions\n", __func__);
+		/* Drop the references, turning back off the partitions which came up */
+		tegrabl_pg_batch_begin();
+		for (domain_id = TEGRA194_POWER_DOMAIN_DISP; domain_id <= TEGRA194_POWER_DOMAIN_DISPC; domain_id++) {
+			(void)tegrabl_pg_put(domain_id);
+		}
+		(void)tegrabl_pg_batch_commit();
+		return;
 	}
+	disp_pg_held = true;
 
 	pr_debug("%s: display unpowergate done\n", __func__);
 }
 
 void tegrabl_display_powergate(void)
 {
-	struct mrq_pg_request disp_pg_request = {
-		.cmd = CMD_PG_SET_STATE,
-		.id = TEGRA194_POWER_DOMAIN_DISP,
-		.set_state = {
-			.state = PG_STATE_OFF,
-		}
-	};
+	uint32_t domain_id;
 
-	while (disp_pg_request.id <= TEGRA194_POWER_DOMAIN_DISPC) {
-		if (tegrabl_ccplex_bpmp_xfer(&disp_pg_request, NULL, sizeof(disp_pg_request),
-				0, MRQ_PG) != TEGRABL_NO_ERROR) {
-			pr_error("%s: Unable to power on - TEGRA194_POWER_DOMAIN_DISP%c\n",
-					 __func__, disp_pg_request.id - TEGRA194_POWER_DOMAIN_DISP == 0 ?
-					 ' ' : disp_pg_request.id - TEGRA194_POWER_DOMAIN_DISP + 'A');
-		}
-
-		(disp_pg_request.id)++;
+	/* DISP is powered off after DISPB and DISPC. Puts force the partitions
+	 * off if they were not powered on through tegrabl_display_unpowergate. */
+	tegrabl_pg_batch_begin();
+	for (domain_id = TEGRA194_POWER_DOMAIN_DISP; domain_id <= TEGRA194_POWER_DOMAIN_DISPC; domain_id++) {
+		(void)tegrabl_pg_put(domain_id);
+	}
+	disp_pg_held = false;
+	if (tegrabl_pg_batch_commit() != TEGRABL_NO_ERROR) {
+		pr_error("%s: Unable to power off display partitions\n", __func__);
 	}
 
 	pr_debug("%s: display powergate done\n", __func__);
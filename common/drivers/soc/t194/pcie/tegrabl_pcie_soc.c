@@ -16,8 +16,10 @@
 #include <string.h>
 #include <tegrabl_io.h>
 #include <tegrabl_clock.h>
+#include <tegrabl_soc_clock.h>
 #include <tegrabl_timer.h>
 #include <tegrabl_pcie.h>
+#include <tegrabl_pcie_soc.h>
 #include <address_map_new.h>
 #include <tegrabl_pcie_soc_local.h>
 #include <powergate-t194.h>
@@ -26,8 +28,11 @@
 #include <tegrabl_regulator.h>
 #include <tegrabl_gpio.h>
 #include <tegrabl_utils.h>
+#include <tegrabl_compiler.h>
 #include <tegrabl_malloc.h>
 #include <tegrabl_error.h>
+#include <tegrabl_odmdata_soc.h>
+#include <tegrabl_profiler.h>
 
 /**
  * @brief Maximum number of PCIe controllers supported by a chip
@@ -90,9 +95,19 @@ uint32_t max_ctrl_supported = MAX_CTRL_SUPPORTED;
 #define LTSSM_STATE_DETECT_ACT					0x08
 #define LTSSM_STATE_PRE_DETECT_QUIET			0x28
 #define LTSSM_STATE_DETECT_WAIT					0x30
+#define LTSSM_STATE_L0							0x88
 #define LTSSM_DELAY								10000
 #define LTSSM_TIMEOUT							120000
 
+/* Time an empty slot is allowed to stay in Detect before giving up on it */
+#define LTSSM_DETECT_TIMEOUT_US					100000U
+/* Time allowed for a link to come up once a receiver has been detected */
+#define LINK_UP_TIMEOUT_US						1000000U
+/* Time allowed for a speed change or retrain to complete */
+#define LINK_RETRAIN_TIMEOUT_US					100000U
+/* Time a link has to stay in L0 to be considered stable at its speed */
+#define LINK_STABLE_TIME_US						10000U
+
 #define PORT_LOGIC_AUX_CLK_FREQ_OFF				0xb40
 #define AUX_CLK_FREQ_MASK						GENMASK(9, 0)
 #define AUX_CLK_FREQ_SHIFT						0
@@ -110,11 +125,53 @@ uint32_t max_ctrl_supported = MAX_CTRL_SUPPORTED;
 #define LINK_CAPABLE_MASK						GENMASK(21, 16)
 #define LINK_CAPABLE_SHIFT						16
 
+#define PCIE_MAX_LANES							8U
+#define PCIE_MAX_PLAT_GPIOS						4U
+#define PCIE_MAX_HANDOFF_BARS					8U
+
 #define PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG	0x80
+#define PCIE_CAP_RETRAIN_LINK					BIT(5)
+#define PCIE_CAP_LINK_SPEED_MASK				GENMASK(19, 16)
+#define PCIE_CAP_LINK_SPEED_SHIFT				16
+#define PCIE_CAP_NEGO_LINK_WIDTH_MASK			GENMASK(25, 20)
+#define PCIE_CAP_NEGO_LINK_WIDTH_SHIFT			20
+#define PCIE_CAP_LINK_TRAINING					BIT(27)
 #define PCIE_CAP_LINK_DISABLE					BIT(4)
 #define PCIE_CAP_LINK_DISABLE_MASK				GENMASK(4, 4)
 #define PCIE_CAP_LINK_DISABLE_SHIFT				4
 
+#define PCIE_CAP_LINK_CAPABILITIES_REG			0x7c
+#define PCIE_CAP_MAX_LINK_SPEED_MASK			GENMASK(3, 0)
+
+/* Endpoint configuration space, reached through an outbound iATU region */
+#define PCI_STATUS_COMMAND_REG					0x04
+#define PCI_CLASS_REVISION_REG					0x08
+#define PCI_CLASS_SHIFT							8
+#define PCI_CLASS_NVME							0x010802U	/* mass storage, NVM, NVMe */
+#define PCI_PRIMARY_BUS_REG						0x18
+#define PCI_BUS_NUMBERS_MASK					GENMASK(23, 0)
+#define PCI_BUS_NUMBERS_EP						((1U << 16) | (1U << 8))	/* pri 0, sec 1, sub 1 */
+#define PCI_STATUS_CAP_LIST						BIT(20)
+#define PCI_CAPABILITY_LIST_REG					0x34
+#define PCI_CAP_ID_EXP							0x10U
+#define PCI_EXP_LNKCAP							0x0c
+#define PCI_CAP_WALK_MAX						48U
+
+#define PCIE_ATU_CFG_REGION						0U
+#define PCIE_ATU_REGION_OFF(region)				((region) << 9)
+#define PCIE_ATU_REGION_CTRL1					0x00
+#define PCIE_ATU_TYPE_CFG0						0x4U
+#define PCIE_ATU_REGION_CTRL2					0x04
+#define PCIE_ATU_ENABLE							BIT(31)
+#define PCIE_ATU_LOWER_BASE						0x08
+#define PCIE_ATU_UPPER_BASE						0x0c
+#define PCIE_ATU_LIMIT							0x10
+#define PCIE_ATU_LOWER_TARGET					0x14
+#define PCIE_ATU_UPPER_TARGET					0x18
+#define PCIE_ATU_BUS(bus)						((uint32_t)(bus) << 24)
+#define PCIE_ATU_CFG_SIZE						0x1000U
+#define PCIE_ATU_REGION_NUM_REGS				7U	/* CTRL1 to UPPER_TARGET */
+
 #define P2U_CONTROL_GEN1									0x78
 #define P2U_CONTROL_GEN1_ENABLE_RXIDLE_ENTRY_ON_LINK_STATUS	BIT(2)
 #define P2U_CONTROL_GEN1_ENABLE_RXIDLE_ENTRY_ON_EIOS		BIT(3)
@@ -206,16 +263,219 @@ static uint32_t pcie_mem_base[] = {
 #define PCIE_COMPATIBLE "nvidia,tegra194-pcie"
 #define PCIE_PHY_COMPATIBLE "nvidia,phy-p2u"
 #define PROPERTY_PHYS "phys"
-#define PROPERTY_PHANDLE "phandle"
 #define PROPERTY_VOLTAGE "regulator-max-microvolt"
+#define PROPERTY_RAMP_DELAY "regulator-enable-ramp-delay"
 #define PROPERTY_PLAT_GPIOS "nvidia,plat-gpios"
+#define PROPERTY_NUM_LANES "num-lanes"
+#define PROPERTY_MAX_SPEED "nvidia,max-speed"
+#define PROPERTY_BOOT_PRIORITY "nvidia,boot-priority"
 
 static char *pcie_regulator_names[2] = {
 	"vpcie3v3-supply",
 	"vpcie12v-supply",
 };
 
-static int32_t pcie_ctrl_regulator_handles[MAX_CTRL_SUPPORTED][2];
+/**
+ * @brief Supply turned on for one or more controllers
+ *
+ * @param phandle phandle of the regulator, 0 for a free entry
+ * @param ctrl_mask bitmask of the controllers using the supply
+ */
+struct tegrabl_pcie_supply {
+	int32_t phandle;
+	uint32_t ctrl_mask;
+};
+
+static struct tegrabl_pcie_supply pcie_supplies[MAX_CTRL_SUPPORTED * ARRAY_SIZE(pcie_regulator_names)];
+
+static uint32_t pcie_detect_timeout_us = LTSSM_DETECT_TIMEOUT_US;
+
+/**
+ * @brief Link configuration and training outcome of a controller
+ *
+ * @param num_lanes link width the controller is configured for
+ * @param max_speed highest speed the controller is allowed to train at
+ * @param speed negotiated link speed
+ * @param width negotiated link width
+ * @param retries number of retrains at a lower speed
+ */
+struct tegrabl_pcie_link_state {
+	uint8_t num_lanes;
+	uint8_t max_speed;
+	uint8_t speed;
+	uint8_t width;
+	uint8_t retries;
+};
+
+static struct tegrabl_pcie_link_state pcie_link_state[MAX_CTRL_SUPPORTED];
+
+/* Profiler records carry no payload, the link outcome goes in the name: "PCIe C4 gen3 x4 r1" */
+#define PCIE_LINK_PROFILER_STR_LEN				32U
+
+/* Link training telemetry events */
+#define PCIE_TLM_LTSSM							1U	/* value: new LTSSM state */
+#define PCIE_TLM_UNPOWERGATE					2U	/* value: latency in us */
+#define PCIE_TLM_CLK_RST						3U	/* value: latency in us */
+#define PCIE_TLM_REGULATORS						4U	/* value: latency in us */
+#define PCIE_TLM_PERST							5U	/* value: time PERST# was held in us */
+#define PCIE_TLM_LINK							6U	/* value: speed | width << 8 | retries << 16 */
+
+#if defined(CONFIG_ENABLE_PCIE_TELEMETRY)
+/*
+ * Link training telemetry of each controller, kept in a fixed size ring
+ * where the oldest events get overwritten. Each event is two 32-bit words:
+ * the timestamp in us, then event << PCIE_TLM_EVENT_SHIFT | value.
+ */
+#define PCIE_TLM_RING_SIZE						32U
+#define PCIE_TLM_EVENT_SHIFT					24
+#define PCIE_TLM_VALUE_MASK						0xffffffU
+
+struct tegrabl_pcie_tlm_entry {
+	uint32_t timestamp_us;
+	uint32_t data;
+};
+
+/**
+ * @brief Telemetry ring of a controller
+ *
+ * @param entries ring storage
+ * @param count number of events recorded so far, including overwritten ones
+ * @param last_ltssm last LTSSM state recorded
+ * @param is_ltssm_valid false until an LTSSM state is recorded for the current training
+ */
+struct tegrabl_pcie_tlm_ring {
+	struct tegrabl_pcie_tlm_entry entries[PCIE_TLM_RING_SIZE];
+	uint32_t count;
+	uint32_t last_ltssm;
+	bool is_ltssm_valid;
+};
+
+static struct tegrabl_pcie_tlm_ring pcie_tlm[MAX_CTRL_SUPPORTED];
+
+static const char * const pcie_tlm_event_names[] = {
+	[PCIE_TLM_LTSSM] = "ltssm",
+	[PCIE_TLM_UNPOWERGATE] = "unpowergate",
+	[PCIE_TLM_CLK_RST] = "clk/rst",
+	[PCIE_TLM_REGULATORS] = "regulators",
+	[PCIE_TLM_PERST] = "perst",
+	[PCIE_TLM_LINK] = "link",
+};
+
+static void tegrabl_pcie_tlm_record(uint8_t ctrl_num, uint32_t event, uint32_t value)
+{
+	struct tegrabl_pcie_tlm_ring *ring = &pcie_tlm[ctrl_num];
+	struct tegrabl_pcie_tlm_entry *entry = &ring->entries[ring->count % PCIE_TLM_RING_SIZE];
+
+	entry->timestamp_us = tegrabl_get_timestamp_us();
+	entry->data = (event << PCIE_TLM_EVENT_SHIFT) | (value & PCIE_TLM_VALUE_MASK);
+	ring->count++;
+}
+
+/* Record an LTSSM state (as masked from APPL_DEBUG) if it changed since the last sample */
+static void tegrabl_pcie_tlm_ltssm(uint8_t ctrl_num, uint32_t ltssm_state)
+{
+	struct tegrabl_pcie_tlm_ring *ring = &pcie_tlm[ctrl_num];
+
+	if (ring->is_ltssm_valid && (ring->last_ltssm == ltssm_state)) {
+		return;
+	}
+	ring->last_ltssm = ltssm_state;
+	ring->is_ltssm_valid = true;
+	tegrabl_pcie_tlm_record(ctrl_num, PCIE_TLM_LTSSM, ltssm_state >> SMLH_LTSSM_STATE_SHIFT);
+}
+
+static void tegrabl_pcie_tlm_start_training(uint8_t ctrl_num)
+{
+	pcie_tlm[ctrl_num].is_ltssm_valid = false;
+}
+
+/* Index of the oldest event still present in the ring */
+static uint32_t tegrabl_pcie_tlm_first(struct tegrabl_pcie_tlm_ring *ring)
+{
+	return (ring->count > PCIE_TLM_RING_SIZE) ? (ring->count - PCIE_TLM_RING_SIZE) : 0U;
+}
+
+/**
+ * @brief Print the link training telemetry of a controller on the console
+ *
+ * @param[in] ctrl_num controller number
+ */
+void tegrabl_pcie_soc_dump_telemetry(uint8_t ctrl_num)
+{
+	struct tegrabl_pcie_tlm_ring *ring;
+	struct tegrabl_pcie_tlm_entry *entry;
+	uint32_t event;
+	uint32_t i;
+
+	if (ctrl_num >= max_ctrl_supported) {
+		return;
+	}
+
+	ring = &pcie_tlm[ctrl_num];
+	pr_info("PCIe controller-%u telemetry (%u events, %u lost):\n", ctrl_num, ring->count,
+			tegrabl_pcie_tlm_first(ring));
+	for (i = tegrabl_pcie_tlm_first(ring); i < ring->count; i++) {
+		entry = &ring->entries[i % PCIE_TLM_RING_SIZE];
+		event = entry->data >> PCIE_TLM_EVENT_SHIFT;
+		pr_info("  %10u us %-12s 0x%06x\n", entry->timestamp_us,
+				(event < ARRAY_SIZE(pcie_tlm_event_names)) ? pcie_tlm_event_names[event] : "?",
+				entry->data & PCIE_TLM_VALUE_MASK);
+	}
+}
+
+/*
+ * Binding (in the "nvidia,tegra194-pcie" node):
+ *   nvidia,bl-link-telemetry = <timestamp-us event-value>, ...;
+ *
+ * Events are in chronological order, event-value is event << 24 | value with
+ * the event codes of PCIE_TLM_*.
+ */
+static tegrabl_error_t tegrabl_pcie_add_telemetry_info(void *fdt, int32_t node_offset, uint8_t ctrl_num)
+{
+	struct tegrabl_pcie_tlm_ring *ring = &pcie_tlm[ctrl_num];
+	struct tegrabl_pcie_tlm_entry *entry;
+	uint32_t buf[PCIE_TLM_RING_SIZE * 2U];
+	uint32_t n = 0;
+	uint32_t i;
+	int dterr;
+
+	if (ring->count == 0U) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	for (i = tegrabl_pcie_tlm_first(ring); i < ring->count; i++) {
+		entry = &ring->entries[i % PCIE_TLM_RING_SIZE];
+		buf[n++] = cpu_to_fdt32(entry->timestamp_us);
+		buf[n++] = cpu_to_fdt32(entry->data);
+	}
+
+	dterr = fdt_setprop(fdt, node_offset, "nvidia,bl-link-telemetry", buf, n * sizeof(uint32_t));
+	if (dterr < 0) {
+		pr_error("%s: failed to add controller-%u telemetry (%s)\n", __func__, ctrl_num, fdt_strerror(dterr));
+		return TEGRABL_ERR_ADD_FAILED;
+	}
+
+	return TEGRABL_NO_ERROR;
+}
+#else
+static void tegrabl_pcie_tlm_record(uint8_t ctrl_num, uint32_t event, uint32_t value)
+{
+	(void)ctrl_num;
+	(void)event;
+	(void)value;
+}
+
+static void tegrabl_pcie_tlm_ltssm(uint8_t ctrl_num, uint32_t ltssm_state)
+{
+	(void)ctrl_num;
+	(void)ltssm_state;
+}
+
+static void tegrabl_pcie_tlm_start_training(uint8_t ctrl_num)
+{
+	(void)ctrl_num;
+}
+#endif /* CONFIG_ENABLE_PCIE_TELEMETRY */
 
 /**
  * @brief API to get DBI base address
@@ -257,6 +517,16 @@ uint32_t *tegrabl_pcie_get_mem_base(void)
 	return &pcie_mem_base[0];
 }
 
+/* Controllers holding a reference on their power partition, C1-C3 share PCIEX1A */
+static uint8_t pcie_pg_held;
+
+#if defined(CONFIG_ENABLE_NVME_BOOT)
+/* Controllers named by the NVMe boot device, after discovery just the selected one */
+static uint8_t pcie_boot_ctrls;
+/* Controllers left trained by tegrabl_pcie_soc_discover, not yet handed to the NVMe driver */
+static uint8_t pcie_discovered;
+#endif
+
 static uintptr_t appl_reg_offset[6] = {
 	NV_ADDRESS_MAP_PCIE_C0_CTL_BASE,
 	NV_ADDRESS_MAP_PCIE_C1_CTL_BASE,
@@ -308,68 +578,273 @@ static tegrabl_error_t tegra_reg_poll_mask(uintptr_t reg, uint32_t mask, uint32_
 	return ret;
 }
 
-/* returns pcie controller node_offset in fdt */
-static tegrabl_error_t tegrabl_locate_pcie_ctrl_in_dt(void *fdt, uint8_t ctrl_num, int32_t *ctrl_offset)
+/**
+ * @brief Platform GPIO driving the slot power of a controller
+ */
+struct tegrabl_pcie_gpio {
+	uint32_t phandle;
+	uint32_t pin;
+	uint32_t polarity;
+};
+
+/**
+ * @brief DT and ODMDATA configuration of a PCIe controller, resolved once
+ *
+ * @param is_present true if the controller has a node in the DT
+ * @param is_available true if the controller node is enabled
+ * @param node_offset offset of the controller node in the DT
+ * @param num_phys number of entries in phy_base
+ * @param phy_base base addresses of the P2U phys listed in "phys"
+ * @param num_supplies number of entries in supply_phandle and supply_uv
+ * @param supply_phandle phandles of the supplies in pcie_regulator_names
+ * @param supply_uv voltage of each supply, 0 if not specified
+ * @param supply_ramp_us time each supply takes to settle once enabled
+ * @param num_gpios number of entries in gpios, only used without supplies
+ * @param gpios platform GPIOs in "nvidia,plat-gpios"
+ * @param num_lanes link width from "num-lanes", capped by odm_lanes
+ * @param max_speed link speed limit from "nvidia,max-speed", 0 if none
+ * @param odm_lanes number of UPHY lanes ODMDATA assigns to the controller
+ * @param boot_priority boot order from "nvidia,boot-priority", lowest first
+ */
+struct tegrabl_pcie_ctrl_desc {
+	bool is_present;
+	bool is_available;
+	int32_t node_offset;
+	uint32_t num_phys;
+	uintptr_t phy_base[PCIE_MAX_LANES];
+	uint32_t num_supplies;
+	int32_t supply_phandle[ARRAY_SIZE(pcie_regulator_names)];
+	uint32_t supply_uv[ARRAY_SIZE(pcie_regulator_names)];
+	uint32_t supply_ramp_us[ARRAY_SIZE(pcie_regulator_names)];
+	uint32_t num_gpios;
+	struct tegrabl_pcie_gpio gpios[PCIE_MAX_PLAT_GPIOS];
+	uint8_t num_lanes;
+	uint8_t max_speed;
+	uint8_t odm_lanes;
+	uint32_t boot_priority;
+};
+
+static struct tegrabl_pcie_ctrl_desc pcie_ctrl_desc[MAX_CTRL_SUPPORTED];
+static bool is_pcie_ctrl_desc_parsed;
+
+static void tegrabl_pcie_parse_phys(void *fdt, struct tegrabl_pcie_ctrl_desc *desc)
+{
+	const uint32_t *phys_list;
+	int32_t phy_offset;
+	int len = 0;
+	uint32_t n_phys;
+	uint32_t i;
+
+	/* not really an error, some controller has no "phys" property */
+	phys_list = fdt_getprop(fdt, desc->node_offset, PROPERTY_PHYS, &len);
+	if (phys_list == NULL) {
+		return;
+	}
+
+	n_phys = MIN((uint32_t)len / sizeof(uint32_t), ARRAY_SIZE(desc->phy_base));
+	for (i = 0; i < n_phys; i++) {
+		phy_offset = fdt_node_offset_by_phandle(fdt, fdt32_to_cpu(phys_list[i]));
+		if ((phy_offset < 0) || (fdt_node_check_compatible(fdt, phy_offset, PCIE_PHY_COMPATIBLE) != 0) ||
+			(tegrabl_dt_read_reg_by_index(fdt, phy_offset, 0, &desc->phy_base[desc->num_phys], NULL) !=
+			 TEGRABL_NO_ERROR)) {
+			pr_error("%s: failed to resolve phy 0x%x\n", __func__, fdt32_to_cpu(phys_list[i]));
+			continue;
+		}
+		desc->num_phys++;
+	}
+}
+
+static void tegrabl_pcie_parse_supplies(void *fdt, struct tegrabl_pcie_ctrl_desc *desc)
 {
-	tegrabl_error_t err = TEGRABL_NO_ERROR;
-	uint8_t i;
-	int32_t node_offset = 0;
-	uintptr_t pcie_addr;
+	const uint32_t *temp;
+	int32_t reg_node_offset;
+	int32_t reg_phandle;
+	uint32_t n_gpios;
+	int len = 0;
+	uint32_t i;
 
-	/* scan the DT tree for a PCI_COMPATIBLE node */
-	for  (i = 0; i < max_ctrl_supported; ++i) {
-		err = tegrabl_dt_get_node_with_compatible(fdt, node_offset, PCIE_COMPATIBLE, &node_offset);
-		if (TEGRABL_NO_ERROR != err) {
-			pr_error("%s: compatible node not found; error=0x%x\n", __func__, err);
-			goto fail;
+	for (i = 0; i < ARRAY_SIZE(pcie_regulator_names); i++) {
+		temp = fdt_getprop(fdt, desc->node_offset, pcie_regulator_names[i], NULL);
+		if (temp == NULL) {
+			pr_info("%s not found\n", pcie_regulator_names[i]);
+			continue;
 		}
 
-		/* parse the reg prop to match with ctrl_num's address */
-		err = tegrabl_dt_read_reg_by_index(fdt, node_offset, 0, &pcie_addr, NULL);
-		if (err != TEGRABL_NO_ERROR) {
-			pr_error("%s: failed to get pcie address\n", __func__);
-			goto fail;
+		reg_phandle = fdt32_to_cpu(*temp);
+		if (reg_phandle == 0) {
+			continue;
 		}
 
-		if (pcie_addr == appl_reg_offset[ctrl_num]) {
-			pr_info("%s: found match at 0x%lx\n", __func__, pcie_addr);
-			*ctrl_offset = node_offset;
-			break;
+		desc->supply_phandle[desc->num_supplies] = reg_phandle;
+		desc->supply_uv[desc->num_supplies] = 0;
+		desc->supply_ramp_us[desc->num_supplies] = 0;
+		reg_node_offset = fdt_node_offset_by_phandle(fdt, reg_phandle);
+		temp = fdt_getprop(fdt, reg_node_offset, PROPERTY_VOLTAGE, NULL);
+		if (temp != NULL) {
+			desc->supply_uv[desc->num_supplies] = fdt32_to_cpu(*temp);
+		}
+		temp = fdt_getprop(fdt, reg_node_offset, PROPERTY_RAMP_DELAY, NULL);
+		if (temp != NULL) {
+			desc->supply_ramp_us[desc->num_supplies] = fdt32_to_cpu(*temp);
 		}
+		desc->num_supplies++;
 	}
 
-	if (i >= max_ctrl_supported) {
-		pr_error("%s: cannot find controller\n", __func__);
-		err = TEGRABL_ERR_NOT_SUPPORTED;
-		goto fail;
+	/* If DT has no pcie_regulator_names, try to look for "nvidia,plat-gpios" */
+	if (desc->num_supplies != 0U) {
+		return;
+	}
 
+	temp = fdt_getprop(fdt, desc->node_offset, PROPERTY_PLAT_GPIOS, &len);
+	if (temp == NULL) {
+		return;
 	}
 
-fail:
-	return err;
+	n_gpios = MIN((uint32_t)len / (3U * sizeof(uint32_t)), ARRAY_SIZE(desc->gpios));
+	for (i = 0; i < n_gpios; i++) {
+		desc->gpios[i].phandle = fdt32_to_cpu(temp[0]);
+		desc->gpios[i].pin = fdt32_to_cpu(temp[1]);
+		desc->gpios[i].polarity = fdt32_to_cpu(temp[2]);
+		temp += 3;
+	}
+	desc->num_gpios = n_gpios;
 }
 
-/* returns pcie controller node offset in fdt */
-int32_t tegrabl_get_pcie_ctrl_node_offset(uint8_t ctrl_num)
+static void tegrabl_pcie_parse_link_config(void *fdt, uint8_t ctrl_num, struct tegrabl_pcie_ctrl_desc *desc)
+{
+	const uint32_t *temp;
+	uint32_t val;
+
+	temp = fdt_getprop(fdt, desc->node_offset, PROPERTY_NUM_LANES, NULL);
+	if (temp != NULL) {
+		val = fdt32_to_cpu(*temp);
+		if ((val != 0U) && (val <= PCIE_MAX_LANES) && ((val & (val - 1U)) == 0U)) {
+			desc->num_lanes = (uint8_t)val;
+		} else {
+			pr_warn("%s: invalid %s %u for controller-%u\n", __func__, PROPERTY_NUM_LANES, val, ctrl_num);
+		}
+	}
+
+	temp = fdt_getprop(fdt, desc->node_offset, PROPERTY_MAX_SPEED, NULL);
+	if (temp != NULL) {
+		desc->max_speed = (uint8_t)fdt32_to_cpu(*temp);
+	}
+
+	temp = fdt_getprop(fdt, desc->node_offset, PROPERTY_BOOT_PRIORITY, NULL);
+	if (temp != NULL) {
+		desc->boot_priority = fdt32_to_cpu(*temp);
+	}
+
+	if ((desc->odm_lanes != 0U) && (desc->odm_lanes < desc->num_lanes)) {
+		pr_warn("%s: controller-%u owns only %u lanes per ODMDATA\n", __func__, ctrl_num, desc->odm_lanes);
+		desc->num_lanes = desc->odm_lanes;
+	}
+}
+
+/**
+ * @brief Resolve the DT and ODMDATA configuration of all the controllers in a
+ * single pass over the DT. Later calls return the cached result.
+ *
+ * @return TEGRABL_NO_ERROR if successful, appropriate error otherwise
+ */
+static tegrabl_error_t tegrabl_pcie_parse_ctrl_descs(void)
 {
 	tegrabl_error_t err = TEGRABL_NO_ERROR;
+	struct tegrabl_pcie_ctrl_desc *desc;
 	int32_t node_offset = 0;
+	uintptr_t pcie_addr;
+	uint8_t ctrl_num;
 	void *fdt;
 
+	if (is_pcie_ctrl_desc_parsed) {
+		goto fail;
+	}
+
 	err = tegrabl_dt_get_fdt_handle(TEGRABL_DT_BL, &fdt);
 	if (TEGRABL_NO_ERROR != err) {
 		pr_error("%s: failed to get DT_BL; error=0x%x\n", __func__, err);
 		goto fail;
 	}
 
-	err = tegrabl_locate_pcie_ctrl_in_dt(fdt, ctrl_num, &node_offset);
+	memset(pcie_ctrl_desc, 0, sizeof(pcie_ctrl_desc));
+	for (ctrl_num = 0; ctrl_num < max_ctrl_supported; ctrl_num++) {
+		pcie_ctrl_desc[ctrl_num].num_lanes = 1;
+		pcie_ctrl_desc[ctrl_num].boot_priority = UINT32_MAX;
+		pcie_ctrl_desc[ctrl_num].odm_lanes = tegrabl_odmdata_get_pcie_num_lanes(ctrl_num);
+	}
+
+	/* scan the DT tree once for all PCI_COMPATIBLE nodes */
+	while (tegrabl_dt_get_node_with_compatible(fdt, node_offset, PCIE_COMPATIBLE, &node_offset) ==
+		   TEGRABL_NO_ERROR) {
+		/* parse the reg prop to match with ctrl_num's address */
+		if (tegrabl_dt_read_reg_by_index(fdt, node_offset, 0, &pcie_addr, NULL) != TEGRABL_NO_ERROR) {
+			pr_error("%s: failed to get pcie address\n", __func__);
+			continue;
+		}
+
+		for (ctrl_num = 0; ctrl_num < max_ctrl_supported; ctrl_num++) {
+			if (pcie_addr == appl_reg_offset[ctrl_num]) {
+				break;
+			}
+		}
+		if ((ctrl_num >= max_ctrl_supported) || pcie_ctrl_desc[ctrl_num].is_present) {
+			continue;
+		}
+
+		pr_info("%s: found controller-%u at 0x%lx\n", __func__, ctrl_num, pcie_addr);
+		desc = &pcie_ctrl_desc[ctrl_num];
+		desc->is_present = true;
+		desc->node_offset = node_offset;
+		if (tegrabl_dt_is_device_available(fdt, node_offset, &desc->is_available) != TEGRABL_NO_ERROR) {
+			desc->is_available = false;
+		}
+		tegrabl_pcie_parse_phys(fdt, desc);
+		tegrabl_pcie_parse_supplies(fdt, desc);
+		tegrabl_pcie_parse_link_config(fdt, ctrl_num, desc);
+	}
+
+	is_pcie_ctrl_desc_parsed = true;
+
+fail:
+	return err;
+}
+
+/**
+ * @brief Get the resolved configuration of a controller
+ *
+ * @param[in] ctrl_num controller number
+ * @param[out] desc descriptor of the controller
+ *
+ * @return TEGRABL_NO_ERROR if successful, appropriate error otherwise
+ */
+static tegrabl_error_t tegrabl_pcie_get_ctrl_desc(uint8_t ctrl_num, struct tegrabl_pcie_ctrl_desc **desc)
+{
+	tegrabl_error_t err;
+
+	if (ctrl_num >= max_ctrl_supported) {
+		return TEGRABL_ERR_NOT_SUPPORTED;
+	}
+
+	err = tegrabl_pcie_parse_ctrl_descs();
 	if (err != TEGRABL_NO_ERROR) {
+		return err;
+	}
+
+	*desc = &pcie_ctrl_desc[ctrl_num];
+	return TEGRABL_NO_ERROR;
+}
+
+/* returns pcie controller node offset in fdt */
+int32_t tegrabl_get_pcie_ctrl_node_offset(uint8_t ctrl_num)
+{
+	struct tegrabl_pcie_ctrl_desc *desc;
+
+	if ((tegrabl_pcie_get_ctrl_desc(ctrl_num, &desc) != TEGRABL_NO_ERROR) || !desc->is_present) {
 		pr_error("%s: no pcie controller node found in DT\n", __func__);
-		goto fail;
+		return 0;
 	}
 
-fail:
-    return node_offset;
+	return desc->node_offset;
 }
 
 static void tegrabl_power_on_one_phy(uintptr_t base)
@@ -416,16 +891,10 @@ static void tegrabl_power_on_one_phy(uintptr_t base)
 tegrabl_error_t tegrabl_power_on_phy(uint8_t ctrl_num)
 {
 	tegrabl_error_t err;
-	void *fdt;
+	struct tegrabl_pcie_ctrl_desc *desc;
 	uintptr_t base, ptr;
 	uint32_t val;
-	const uint32_t *temp;
-	int32_t node_offset = 0;
-	uintptr_t phy_addr;
-	uint32_t n_phys = 0;
-	const uint32_t *phys_list;
-	uint32_t phy_phandle, cur_phandle;
-	bool is_available;
+	uint32_t i;
 
 	if (ctrl_num >= max_ctrl_supported) {
 		err = TEGRABL_ERR_NOT_SUPPORTED;
@@ -444,189 +913,315 @@ tegrabl_error_t tegrabl_power_on_phy(uint8_t ctrl_num)
 		NV_WRITE32(ptr, val);
 	}
 
-	err = tegrabl_dt_get_fdt_handle(TEGRABL_DT_BL, &fdt);
-	if (TEGRABL_NO_ERROR != err) {
-		pr_error("%s: failed to get DT_BL; error=0x%x\n", __func__, err);
-		goto fail;
-	}
-
-	err = tegrabl_locate_pcie_ctrl_in_dt(fdt, ctrl_num, &node_offset);
+	err = tegrabl_pcie_get_ctrl_desc(ctrl_num, &desc);
 	if (err != TEGRABL_NO_ERROR) {
-		pr_error("%s: no pcie controller node found in DT\n", __func__);
 		goto fail;
 	}
 
-	err = tegrabl_dt_is_device_available(fdt, node_offset, &is_available);
-	if (err != TEGRABL_NO_ERROR) {
-		pr_error("%s %d failed\n", __func__, __LINE__);
+	if (!desc->is_present) {
+		pr_error("%s: no pcie controller node found in DT\n", __func__);
+		err = TEGRABL_ERR_NOT_SUPPORTED;
 		goto fail;
 	}
 
-	if (!is_available) {
+	if (!desc->is_available) {
 		pr_info("%s: controller %u not available\n", __func__, ctrl_num);
 		err = TEGRABL_ERR_NOT_SUPPORTED;
 		goto fail;
 	}
 
-	/* find "phys" property in this node */
-	err = tegrabl_dt_count_elems_of_size(fdt, node_offset, PROPERTY_PHYS, 1, &n_phys);
-	n_phys /= sizeof(uint32_t);
-	pr_debug("n_phys=%u, err=0x%x\n", n_phys, err);
-	if (err != TEGRABL_NO_ERROR) {
-		pr_warn("Failed to get %s\n", PROPERTY_PHYS);
-		/* not really an error, some controller has no "phys" property */
-		err = TEGRABL_NO_ERROR;
-		goto fail;
+	for (i = 0; i < desc->num_phys; i++) {
+		pr_info("%s: power on phy @0x%lx\n", __func__, desc->phy_base[i]);
+		tegrabl_power_on_one_phy(desc->phy_base[i]);
 	}
 
-	phys_list = fdt_getprop(fdt, node_offset, PROPERTY_PHYS, NULL);
-	if (!phys_list) {
-		pr_error("Failed to get %s property\n", PROPERTY_PHYS);
-		err = TEGRABL_ERR_NOT_FOUND;
-		goto fail;
-	}
+fail:
+	return err;
+}
 
-	/* For each phy in phys_list, find a phy node that has the matching phy_phandle */
-	while (n_phys) {
-		phy_phandle = fdt32_to_cpu(*phys_list);
-		pr_debug("==== phy phandle=0x%x ===\n", phy_phandle);
+/**
+ * @brief Bring a set of controllers out of powergate and reset together
+ *
+ * The work is planned per phase across all the controllers instead of
+ * controller by controller:
+ *  1. each power partition is unpowergated once, even if shared (C1-C3)
+ *  2. clock and reset sequence of each controller, back to back
+ *  3. UPHY ownership of each controller
+ *  4. the common PCIE_APB:6 reset is released once
+ * and the settle delay following phases 1 and 4 is paid once per phase.
+ *
+ * @param[in] ctrl_nums controllers to be initialized
+ * @param[in] num_ctrls number of entries in ctrl_nums
+ * @param[out] results per controller status
+ *
+ * @return TEGRABL_NO_ERROR if all the controllers succeeded, else the first error
+ */
+tegrabl_error_t tegrabl_pcie_soc_preinit_batch(const uint8_t *ctrl_nums, uint8_t num_ctrls,
+											   tegrabl_error_t *results)
+{
+	tegrabl_bpmp_handle_t apb_rst_clear[MAX_CTRL_SUPPORTED];
+	tegrabl_bpmp_handle_t core_rst;
+	tegrabl_bpmp_handle_t apb_rst;
+	tegrabl_error_t status = TEGRABL_NO_ERROR;
+	tegrabl_error_t error;
+	uint32_t num_pg = 0;
+	uint32_t pg_start;
+	uint32_t start;
+	uint8_t ctrl_num;
+	uint8_t i;
 
-		cur_phandle = (uint32_t)-1;
-		node_offset = 0;
-		while (cur_phandle != phy_phandle) {
-			/* find a DT phy node that has the matching phy_phandle */
-			err = tegrabl_dt_get_node_with_compatible(fdt, node_offset, PCIE_PHY_COMPATIBLE, &node_offset);
-			if (TEGRABL_NO_ERROR != err) {
-				pr_error("%s: %s node not found; error=0x%x\n", __func__, PCIE_PHY_COMPATIBLE, err);
-				goto fail;
-			}
+	if ((ctrl_nums == NULL) || (results == NULL)) {
+		return TEGRABL_ERR_INVALID;
+	}
 
-			temp = fdt_getprop(fdt, node_offset, PROPERTY_PHANDLE, NULL);
-			if (!temp) {
-				pr_error("Failed to get %s property\n", PROPERTY_PHANDLE);
-				err = TEGRABL_ERR_NOT_FOUND;
-				goto fail;
-			}
+	/* Phase 1: unpowergate the partitions */
+	pg_start = tegrabl_get_timestamp_us();
+	for (i = 0; i < num_ctrls; i++) {
+		ctrl_num = ctrl_nums[i];
+		pr_info("%s: (%u):\n", __func__, ctrl_num);
+		if (ctrl_num >= max_ctrl_supported) {
+			results[i] = TEGRABL_ERR_INVALID;
+			continue;
+		}
 
-			cur_phandle = fdt32_to_cpu(*temp);
-			pr_debug("phy phandle=0x%x, searching for 0x%x.\n", cur_phandle, phy_phandle);
+		if ((pcie_pg_held & BIT(ctrl_num)) != 0U) {
+			results[i] = TEGRABL_NO_ERROR;
+			continue;
+		}
 
-			if (cur_phandle == phy_phandle) {
-				pr_debug("found one\n");
+		/* A partition shared with a previous controller only gains a reference */
+		pr_info("Unpowergate\n");
+		results[i] = tegrabl_pcie_unpowergate(tegrabl_car_get_pg_id(TEGRABL_MODULE_PCIE_CORE, ctrl_num));
+		if (results[i] != TEGRABL_NO_ERROR) {
+			pr_error("pcie_preinit: Failed to unpowergate (err=%d)\n", results[i]);
+		} else {
+			pcie_pg_held |= (uint8_t)BIT(ctrl_num);
+		}
+		num_pg++;
+	}
+	if (num_pg != 0U) {
+		tegrabl_udelay(100);
+	}
 
-				/* get the reg addr from that node */
-				err = tegrabl_dt_read_reg_by_index(fdt, node_offset, 0, &phy_addr, NULL);
-				if (err != TEGRABL_NO_ERROR) {
-					pr_error("%s: failed to get pcie address\n", __func__);
-					err = TEGRABL_NO_ERROR;
-					goto fail;
-				}
+	/* Phase 2: clocks and resets */
+	start = tegrabl_get_timestamp_us();
+	for (i = 0; i < num_ctrls; i++) {
+		if (results[i] != TEGRABL_NO_ERROR) {
+			continue;
+		}
+		ctrl_num = ctrl_nums[i];
+		tegrabl_pcie_tlm_record(ctrl_num, PCIE_TLM_UNPOWERGATE, start - pg_start);
+
+		/** Assert PEX CORE RST, PEX APB RST and disable PEX CORE CLK */
+		pr_info("tegrabl_car_clk_disable(%u) ...\n", ctrl_num);
+		error = tegrabl_car_clk_disable(TEGRABL_MODULE_PCIE_CORE, ctrl_num);
+		if (error != TEGRABL_NO_ERROR) {
+			goto ctrl_fail;
+		}
+		/* The resets are deferred, clk_enable below dispatches them in order */
+		pr_info("tegrabl_car_rst_set(CORE, %u) ...\n", ctrl_num);
+		error = tegrabl_car_rst_batch_add(TEGRABL_MODULE_PCIE_CORE, ctrl_num, true, &core_rst);
+		if (error != TEGRABL_NO_ERROR) {
+			goto ctrl_fail;
+		}
+		pr_info("tegrabl_car_rst_set(APB, %u) ...\n", ctrl_num);
+		error = tegrabl_car_rst_batch_add(TEGRABL_MODULE_PCIE_APB, ctrl_num, true, &apb_rst);
+		if (error != TEGRABL_NO_ERROR) {
+			goto ctrl_fail;
+		}
 
-				pr_info("%s: power on phy @0x%lx\n", __func__, phy_addr);
-				tegrabl_power_on_one_phy(phy_addr);
-				break;
-			}
+		/** Enable PEX CORE CLK */
+		pr_info("tegrabl_car_clk_enable(%u) ...\n", ctrl_num);
+		error = tegrabl_car_clk_enable(TEGRABL_MODULE_PCIE_CORE, ctrl_num, NULL);
+		if (error != TEGRABL_NO_ERROR) {
+			goto ctrl_fail;
 		}
 
-		phys_list += 1;
-		--n_phys;
-	}
-
-fail:
-	return err;
-}
+		/* Both asserts were dispatched ahead of clk_enable, collect their status */
+		error = tegrabl_bpmp_batch_wait(core_rst, NULL);
+		if (error == TEGRABL_NO_ERROR) {
+			error = tegrabl_bpmp_batch_wait(apb_rst, NULL);
+		}
 
-tegrabl_error_t tegrabl_pcie_soc_preinit(uint8_t ctrl_num)
-{
-	tegrabl_error_t error;
+		/** Deassert PEX APB RST */
+		if (error == TEGRABL_NO_ERROR) {
+			pr_info("tegrabl_car_rst_clear(APB, %u) ...\n", ctrl_num);
+			error = tegrabl_car_rst_batch_add(TEGRABL_MODULE_PCIE_APB, ctrl_num, false, &apb_rst_clear[ctrl_num]);
+		}
+		if (error != TEGRABL_NO_ERROR) {
+			pr_error("%s: reset of controller-%u failed (err=%d)\n", __func__, ctrl_num, error);
+			tegrabl_car_clk_disable(TEGRABL_MODULE_PCIE_CORE, ctrl_num);
+		}
 
-	pr_info("%s: (%u):\n", __func__, ctrl_num);
+ctrl_fail:
+		results[i] = error;
+	}
 
-	pr_info("Unpowergate\n");
-	switch (ctrl_num) {
-	case 0:
-		error = tegrabl_pcie_unpowergate(TEGRA194_POWER_DOMAIN_PCIEX8B);
-		break;
-	case 1:
-	case 2:
-	case 3:
-		error = tegrabl_pcie_unpowergate(TEGRA194_POWER_DOMAIN_PCIEX1A);
-		break;
-	case 4:
-		error = tegrabl_pcie_unpowergate(TEGRA194_POWER_DOMAIN_PCIEX4A);
-		break;
-	case 5:
-		error = tegrabl_pcie_unpowergate(TEGRA194_POWER_DOMAIN_PCIEX8A);
-		break;
-	default:
-		error = TEGRABL_ERR_INVALID;
-		break;
+	/* Collect the status of the APB reset releases still deferred */
+	for (i = 0; i < num_ctrls; i++) {
+		if (results[i] != TEGRABL_NO_ERROR) {
+			continue;
+		}
+		ctrl_num = ctrl_nums[i];
+		results[i] = tegrabl_bpmp_batch_wait(apb_rst_clear[ctrl_num], NULL);
+		if (results[i] != TEGRABL_NO_ERROR) {
+			pr_error("%s: APB reset release of controller-%u failed (err=%d)\n", __func__, ctrl_num,
+					 results[i]);
+			tegrabl_car_clk_disable(TEGRABL_MODULE_PCIE_CORE, ctrl_num);
+		}
 	}
+	/* Every deferred reset has been accounted to its controller above */
+	(void)tegrabl_bpmp_batch_flush();
 
-	if (error != TEGRABL_NO_ERROR) {
-		pr_error("pcie_preinit: Failed to unpowergate (err=%d)\n", error);
-		goto fail;
+	/* Phase 3: UPHY */
+	for (i = 0; i < num_ctrls; i++) {
+		if (results[i] != TEGRABL_NO_ERROR) {
+			continue;
+		}
+		ctrl_num = ctrl_nums[i];
+		pr_info("tegrabl_set_ctrl_state(%u)\n", ctrl_num);
+		results[i] = tegrabl_set_ctrl_state(ctrl_num, true);
+		if (results[i] != TEGRABL_NO_ERROR) {
+			pr_error("%s: Failed to tegrabl_set_ctrl_state (err=%d)\n", __func__, results[i]);
+		}
 	}
-	tegrabl_udelay(100);
 
-	/** Assert PEX CORE RST, PEX APB RST and disable PEX CORE CLK */
-	pr_info("tegrabl_car_clk_disable(%u) ...\n", ctrl_num);
-	error = tegrabl_car_clk_disable(TEGRABL_MODULE_PCIE_CORE, ctrl_num);
-	if (error != TEGRABL_NO_ERROR) {
-		goto fail;
+	/* Phase 4: common APB reset */
+	for (i = 0; i < num_ctrls; i++) {
+		if (results[i] == TEGRABL_NO_ERROR) {
+			break;
+		}
 	}
-	pr_info("tegrabl_car_rst_set(CORE, %u) ...\n", ctrl_num);
-	error = tegrabl_car_rst_set(TEGRABL_MODULE_PCIE_CORE, ctrl_num);
-	if (error != TEGRABL_NO_ERROR) {
-		goto fail;
+	if (i < num_ctrls) {
+		pr_info("CLR PCIE_APB:6\n");
+		error = tegrabl_car_rst_clear(TEGRABL_MODULE_PCIE_APB, 6);
+		tegrabl_udelay(100);
+		if (error != TEGRABL_NO_ERROR) {
+			pr_error("%s: Failed to unreset PCIE_APB:6 (err=%d)\n", __func__, error);
+		}
+		for (; i < num_ctrls; i++) {
+			if (results[i] != TEGRABL_NO_ERROR) {
+				continue;
+			}
+			results[i] = error;
+			if (error == TEGRABL_NO_ERROR) {
+				tegrabl_pcie_tlm_record(ctrl_nums[i], PCIE_TLM_CLK_RST, tegrabl_get_timestamp_us() - start);
+			}
+		}
 	}
-	pr_info("tegrabl_car_rst_set(APB, %u) ...\n", ctrl_num);
-	error = tegrabl_car_rst_set(TEGRABL_MODULE_PCIE_APB, ctrl_num);
-	if (error != TEGRABL_NO_ERROR) {
-		goto fail;
+
+	for (i = 0; i < num_ctrls; i++) {
+		if ((results[i] != TEGRABL_NO_ERROR) && (status == TEGRABL_NO_ERROR)) {
+			status = results[i];
+		}
 	}
 
-	/** Enable PEX CORE CLK */
-	pr_info("tegrabl_car_clk_enable(%u) ...\n", ctrl_num);
-	error = tegrabl_car_clk_enable(TEGRABL_MODULE_PCIE_CORE, ctrl_num, NULL);
-	if (error != TEGRABL_NO_ERROR) {
-		goto fail;
+	return status;
+}
+
+static bool tegrabl_pcie_is_linkup(uint8_t ctrl_num)
+{
+	uint32_t val;
+
+	val = pcie_appl_read32(ctrl_num, APPL_LINK_STATUS);
+	if ((val & RDLH_LINK_UP_MASK) == RDLH_LINK_UP) {
+		return true;
 	}
+	return false;
+}
 
-	/** Deassert PEX APB RST */
-	pr_info("tegrabl_car_rst_clear(APB, %u) ...\n", ctrl_num);
-	error = tegrabl_car_rst_clear(TEGRABL_MODULE_PCIE_APB, ctrl_num);
-	if (error != TEGRABL_NO_ERROR) {
-		tegrabl_car_clk_disable(TEGRABL_MODULE_PCIE_CORE, ctrl_num);
-		goto fail;
+/* Returns true if discovery left the link of the controller up, the NVMe driver need not train it again */
+static bool tegrabl_pcie_is_discovered(uint8_t ctrl_num)
+{
+#if defined(CONFIG_ENABLE_NVME_BOOT)
+	if ((ctrl_num < max_ctrl_supported) && ((pcie_discovered & BIT(ctrl_num)) != 0U)) {
+		if (tegrabl_pcie_is_linkup(ctrl_num)) {
+			return true;
+		}
+		pr_warn("PCIe controller-%u link went down after discovery\n", ctrl_num);
+		pcie_discovered &= (uint8_t)~BIT(ctrl_num);
 	}
+#endif
+	return false;
+}
 
-	pr_info("tegrabl_set_ctrl_state(%u)\n", ctrl_num);
-	error = tegrabl_set_ctrl_state(ctrl_num, true);
-	if (error != TEGRABL_NO_ERROR) {
-		pr_error("%s: Failed to tegrabl_set_ctrl_state (err=%d)\n", __func__, error);
-		goto fail;
+tegrabl_error_t tegrabl_pcie_soc_preinit(uint8_t ctrl_num)
+{
+	tegrabl_error_t result = TEGRABL_NO_ERROR;
+
+	if (tegrabl_pcie_is_discovered(ctrl_num)) {
+		return TEGRABL_NO_ERROR;
 	}
 
-	pr_info("CLR PCIE_APB:6\n");
-	error = tegrabl_car_rst_clear(TEGRABL_MODULE_PCIE_APB, 6);
-	tegrabl_udelay(100);
-	if (error != TEGRABL_NO_ERROR) {
-		pr_error("%s: Failed to unreset PCIE_APB:6 (err=%d)\n", __func__, error);
-		goto fail;
+	return tegrabl_pcie_soc_preinit_batch(&ctrl_num, 1U, &result);
+}
+
+/* Returns true if the LTSSM state (as masked from APPL_DEBUG) is one of the Detect substates */
+static bool tegrabl_pcie_ltssm_in_detect(uint32_t ltssm_state)
+{
+	return (ltssm_state == LTSSM_STATE_DETECT_QUIET) ||
+		   (ltssm_state == LTSSM_STATE_DETECT_ACT) ||
+		   (ltssm_state == LTSSM_STATE_PRE_DETECT_QUIET) ||
+		   (ltssm_state == LTSSM_STATE_DETECT_WAIT);
+}
+
+/**
+ * @brief Set the time a controller may stay in Detect.Quiet/Detect.Active
+ * without detecting a receiver before its link training is abandoned.
+ *
+ * @param[in] timeout_us window in microseconds, 0 to always wait for the full
+ *            link-up timeout
+ */
+void tegrabl_pcie_soc_set_detect_timeout(uint32_t timeout_us)
+{
+	pcie_detect_timeout_us = timeout_us;
+}
+
+/**
+ * @brief Get the link width and speed a controller is to be trained at
+ *
+ * @param[in] ctrl_num controller number
+ * @param[out] num_lanes link width, x1 if not configured
+ * @param[in,out] link_speed requested speed in, speed to be trained at out
+ */
+static void tegrabl_pcie_get_link_config(uint8_t ctrl_num, uint8_t *num_lanes, uint8_t *link_speed)
+{
+	struct tegrabl_pcie_ctrl_desc *desc;
+
+	*num_lanes = 1;
+
+	if (tegrabl_pcie_get_ctrl_desc(ctrl_num, &desc) == TEGRABL_NO_ERROR) {
+		*num_lanes = desc->num_lanes;
+		if ((desc->max_speed != 0U) && (desc->max_speed < *link_speed)) {
+			*link_speed = desc->max_speed;
+		}
 	}
 
-fail:
-	return error;
+	pr_info("%s: controller-%u x%u, gen%u\n", __func__, ctrl_num, *num_lanes, *link_speed);
 }
 
-tegrabl_error_t tegrabl_pcie_soc_init(uint8_t ctrl_num, uint8_t link_speed)
+/**
+ * @brief Program APPL and DBI registers of a controller and leave PERST#
+ * asserted to the endpoint, ready to start link training.
+ *
+ * @param[in] ctrl_num controller to be programmed
+ * @param[in] link_speed target link speed
+ *
+ * @return TEGRABL_NO_ERROR if successful, appropriate error otherwise
+ */
+static tegrabl_error_t tegrabl_pcie_soc_setup_ctrl(uint8_t ctrl_num, uint8_t link_speed)
 {
 	tegrabl_error_t error;
 	uint32_t val;
+	uint8_t num_lanes;
 
 	pr_info("%s: (%u):\n", __func__, ctrl_num);
 
+	tegrabl_pcie_get_link_config(ctrl_num, &num_lanes, &link_speed);
+	memset(&pcie_link_state[ctrl_num], 0, sizeof(pcie_link_state[ctrl_num]));
+	pcie_link_state[ctrl_num].num_lanes = num_lanes;
+	pcie_link_state[ctrl_num].max_speed = link_speed;
+
 	/** APPL initialization before PCIe*/
 	pr_info("APPL initialization ...\n");
 
@@ -675,12 +1270,13 @@ tegrabl_error_t tegrabl_pcie_soc_init(uint8_t ctrl_num, uint8_t link_speed)
 
 	val = pcie_dbi_read32(ctrl_num, PORT_LOGIC_GEN2_CTRL_OFF);
 	val &= ~NUM_OF_LANES_MASK;
-	val |= 1 << NUM_OF_LANES_SHIFT;
+	val |= (uint32_t)num_lanes << NUM_OF_LANES_SHIFT;
 	pcie_dbi_write32(ctrl_num, PORT_LOGIC_GEN2_CTRL_OFF, val);
 
 	val = pcie_dbi_read32(ctrl_num, PORT_LOGIC_PORT_LINK_CTRL_OFF);
 	val &= ~LINK_CAPABLE_MASK;
-	val |= 1 << LINK_CAPABLE_SHIFT;
+	/* One bit per lane: 0x1 for x1, 0x3 for x2, 0x7 for x4, 0xf for x8 */
+	val |= (((uint32_t)num_lanes << 1) - 1U) << LINK_CAPABLE_SHIFT;
 	pcie_dbi_write32(ctrl_num, PORT_LOGIC_PORT_LINK_CTRL_OFF, val);
 
 	/** Deassert PEX_RST signal to endpoint */
@@ -688,37 +1284,585 @@ tegrabl_error_t tegrabl_pcie_soc_init(uint8_t ctrl_num, uint8_t link_speed)
 	val &= ~APPL_PINMUX_PEX_RST;	/* APPL_PINMUX_PEX_RST to 0 */
 	pcie_appl_write32(ctrl_num, APPL_PINMUX, val);
 
+fail:
+	return error;
+}
+
+/**
+ * @brief Poll link-up status of all the pending controllers in a single loop
+ *
+ * A controller which has not left Detect within pcie_detect_timeout_us has no
+ * receiver on the other end and is dropped right away. Only the controllers
+ * which reached Polling or a later state wait for the full timeout.
+ *
+ * @param[in] pending bitmask of controllers whose link training has started
+ * @param[in] timeout_us time to wait for the detected links to come up
+ *
+ * @return bitmask of controllers whose link is up
+ */
+static uint32_t tegrabl_pcie_soc_wait_for_links(uint32_t pending, uint32_t timeout_us)
+{
+	const uint32_t start = tegrabl_get_timestamp_us();
+	uint32_t detected = 0;
+	uint32_t linked = 0;
+	uint32_t elapsed;
+	uint32_t state;
+	uint8_t ctrl_num;
+
+	do {
+		elapsed = tegrabl_get_timestamp_us() - start;
+		for (ctrl_num = 0; ctrl_num < max_ctrl_supported; ctrl_num++) {
+			if ((pending & BIT(ctrl_num)) == 0U) {
+				continue;
+			}
+
+			state = pcie_appl_read32(ctrl_num, APPL_DEBUG) & SMLH_LTSSM_STATE_MASK;
+			tegrabl_pcie_tlm_ltssm(ctrl_num, state);
+
+			if (tegrabl_pcie_is_linkup(ctrl_num)) {
+				pending &= ~BIT(ctrl_num);
+				linked |= BIT(ctrl_num);
+				pr_info("PCIe controller-%d link is up after %u us\n", ctrl_num, elapsed);
+				continue;
+			}
+
+			if (!tegrabl_pcie_ltssm_in_detect(state)) {
+				detected |= BIT(ctrl_num);
+			} else if (((detected & BIT(ctrl_num)) == 0U) && (pcie_detect_timeout_us != 0U) &&
+					   (elapsed >= pcie_detect_timeout_us)) {
+				pending &= ~BIT(ctrl_num);
+				pr_info("PCIe controller-%d: no receiver detected in %u us\n", ctrl_num, elapsed);
+			}
+		}
+	} while ((pending != 0U) && (elapsed < timeout_us));
+
+	return linked;
+}
+
+/* Wait for the link to leave training/recovery and settle in L0 */
+static bool tegrabl_pcie_wait_for_l0(uint8_t ctrl_num)
+{
+	const uint32_t start = tegrabl_get_timestamp_us();
+	uint32_t state;
+
+	do {
+		state = pcie_appl_read32(ctrl_num, APPL_DEBUG) & SMLH_LTSSM_STATE_MASK;
+		tegrabl_pcie_tlm_ltssm(ctrl_num, state);
+		if ((state == LTSSM_STATE_L0) && tegrabl_pcie_is_linkup(ctrl_num) &&
+			((pcie_dbi_read32(ctrl_num, PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG) & PCIE_CAP_LINK_TRAINING) == 0U)) {
+			return true;
+		}
+	} while ((tegrabl_get_timestamp_us() - start) < LINK_RETRAIN_TIMEOUT_US);
+
+	return false;
+}
+
+/* Returns true if the link stays up and in L0 for LINK_STABLE_TIME_US */
+static bool tegrabl_pcie_link_is_stable(uint8_t ctrl_num)
+{
+	const uint32_t start = tegrabl_get_timestamp_us();
+	uint32_t state;
+
+	do {
+		state = pcie_appl_read32(ctrl_num, APPL_DEBUG) & SMLH_LTSSM_STATE_MASK;
+		tegrabl_pcie_tlm_ltssm(ctrl_num, state);
+		if ((state != LTSSM_STATE_L0) || !tegrabl_pcie_is_linkup(ctrl_num)) {
+			return false;
+		}
+	} while ((tegrabl_get_timestamp_us() - start) < LINK_STABLE_TIME_US);
+
+	return true;
+}
+
+/* Region 0 and bus numbers of the root port, as found before the endpoint config space was mapped */
+struct tegrabl_pcie_ep_cfg_ctx {
+	uint32_t atu[PCIE_ATU_REGION_NUM_REGS];
+	uint32_t bus_numbers;
+};
+
+/*
+ * Map the config space of the device on the bus below the root port. The
+ * link is probed ahead of enumeration, so the root port is given bus 1 as its
+ * secondary and subordinate bus for the CFG0 access to be forwarded. Whatever
+ * was programmed in region 0 and in the bus number register is saved in ctx
+ * and put back by tegrabl_pcie_ep_cfg_unmap.
+ */
+static uint32_t tegrabl_pcie_ep_cfg_map(uint8_t ctrl_num, struct tegrabl_pcie_ep_cfg_ctx *ctx)
+{
+	uint32_t atu = iatu_dma_offset[ctrl_num] + PCIE_ATU_REGION_OFF(PCIE_ATU_CFG_REGION);
+	uint32_t cfg = pcie_mem_base[ctrl_num];
+	uint32_t i;
+
+	for (i = 0; i < PCIE_ATU_REGION_NUM_REGS; i++) {
+		ctx->atu[i] = NV_READ32(atu + (i * sizeof(uint32_t)));
+	}
+	ctx->bus_numbers = pcie_dbi_read32(ctrl_num, PCI_PRIMARY_BUS_REG);
+	pcie_dbi_write32(ctrl_num, PCI_PRIMARY_BUS_REG,
+					 (ctx->bus_numbers & ~PCI_BUS_NUMBERS_MASK) | PCI_BUS_NUMBERS_EP);
+
+	NV_WRITE32(atu + PCIE_ATU_REGION_CTRL2, 0);
+	NV_WRITE32(atu + PCIE_ATU_LOWER_BASE, cfg);
+	NV_WRITE32(atu + PCIE_ATU_UPPER_BASE, 0);
+	NV_WRITE32(atu + PCIE_ATU_LIMIT, cfg + PCIE_ATU_CFG_SIZE - 1U);
+	NV_WRITE32(atu + PCIE_ATU_LOWER_TARGET, PCIE_ATU_BUS(1));
+	NV_WRITE32(atu + PCIE_ATU_UPPER_TARGET, 0);
+	NV_WRITE32(atu + PCIE_ATU_REGION_CTRL1, PCIE_ATU_TYPE_CFG0);
+	NV_WRITE32(atu + PCIE_ATU_REGION_CTRL2, PCIE_ATU_ENABLE);
+	/* Read back so that the region is enabled before the first access */
+	(void)NV_READ32(atu + PCIE_ATU_REGION_CTRL2);
+
+	return cfg;
+}
+
+static void tegrabl_pcie_ep_cfg_unmap(uint8_t ctrl_num, const struct tegrabl_pcie_ep_cfg_ctx *ctx)
+{
+	uint32_t atu = iatu_dma_offset[ctrl_num] + PCIE_ATU_REGION_OFF(PCIE_ATU_CFG_REGION);
+	uint32_t i;
+
+	/* Region is re-enabled, if it was, only once it is fully restored */
+	NV_WRITE32(atu + PCIE_ATU_REGION_CTRL2, 0);
+	for (i = 0; i < PCIE_ATU_REGION_NUM_REGS; i++) {
+		if ((i * sizeof(uint32_t)) != PCIE_ATU_REGION_CTRL2) {
+			NV_WRITE32(atu + (i * sizeof(uint32_t)), ctx->atu[i]);
+		}
+	}
+	NV_WRITE32(atu + PCIE_ATU_REGION_CTRL2, ctx->atu[PCIE_ATU_REGION_CTRL2 / sizeof(uint32_t)]);
+	(void)NV_READ32(atu + PCIE_ATU_REGION_CTRL2);
+
+	pcie_dbi_write32(ctrl_num, PCI_PRIMARY_BUS_REG, ctx->bus_numbers);
+}
+
+/* Highest speed advertised in the Link Capabilities of the endpoint, 0 if unknown */
+static uint8_t tegrabl_pcie_ep_max_speed(uint8_t ctrl_num)
+{
+	uint32_t cfg;
+	uint32_t val;
+	uint32_t pos;
+	uint32_t walked;
+	uint8_t speed = 0;
+	struct tegrabl_pcie_ep_cfg_ctx ctx;
+
+	cfg = tegrabl_pcie_ep_cfg_map(ctrl_num, &ctx);
+
+	if ((NV_READ32(cfg) & 0xffffU) == 0xffffU) {
+		goto done;
+	}
+	if ((NV_READ32(cfg + PCI_STATUS_COMMAND_REG) & PCI_STATUS_CAP_LIST) == 0U) {
+		goto done;
+	}
+
+	pos = NV_READ32(cfg + PCI_CAPABILITY_LIST_REG) & 0xfcU;
+	for (walked = 0; (pos != 0U) && (walked < PCI_CAP_WALK_MAX); walked++) {
+		val = NV_READ32(cfg + pos);
+		if ((val & 0xffU) == PCI_CAP_ID_EXP) {
+			val = NV_READ32(cfg + pos + PCI_EXP_LNKCAP);
+			speed = (uint8_t)(val & PCIE_CAP_MAX_LINK_SPEED_MASK);
+			break;
+		}
+		pos = (val >> 8) & 0xfcU;
+	}
+
+done:
+	tegrabl_pcie_ep_cfg_unmap(ctrl_num, &ctx);
+	return speed;
+}
+
+/* Set a new target speed and retrain the link */
+static void tegrabl_pcie_retrain_link(uint8_t ctrl_num, uint8_t link_speed)
+{
+	uint32_t val;
+
+	val = pcie_dbi_read32(ctrl_num, PCIE_CAP_LINK_CONTROL2_LINK_STATUS2_REG);
+	val &= ~PCIE_CAP_TARGET_LINK_SPEED_MASK;
+	val |= link_speed << PCIE_CAP_TARGET_LINK_SPEED_SHIFT;
+	pcie_dbi_write32(ctrl_num, PCIE_CAP_LINK_CONTROL2_LINK_STATUS2_REG, val);
+
+	val = pcie_dbi_read32(ctrl_num, PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG);
+	val |= PCIE_CAP_RETRAIN_LINK;
+	pcie_dbi_write32(ctrl_num, PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG, val);
+}
+
+/**
+ * @brief Bring a trained link to the highest speed it is stable at
+ *
+ * The starting target is the lowest of the speed the controller is allowed,
+ * the Max Link Speed of the root port and the one the endpoint advertises in
+ * its Link Capabilities. If the link did not reach the target, one directed
+ * speed change is requested. A link which does not settle in L0 or drops out
+ * of it is retrained at the next lower speed, down to Gen1. The outcome is
+ * recorded in the boot profiler.
+ *
+ * @param[in] ctrl_num controller whose link is up
+ *
+ * @return TEGRABL_NO_ERROR if the link is up at the end, TEGRABL_ERR_INIT_FAILED otherwise
+ */
+static tegrabl_error_t tegrabl_pcie_soc_negotiate_speed(uint8_t ctrl_num)
+{
+	struct tegrabl_pcie_link_state *link = &pcie_link_state[ctrl_num];
+	uint8_t target = link->max_speed;
+	uint8_t cap;
+	bool speed_change_requested = false;
+	uint32_t val;
+	char profiler_str[PCIE_LINK_PROFILER_STR_LEN];
+
+	cap = (uint8_t)(pcie_dbi_read32(ctrl_num, PCIE_CAP_LINK_CAPABILITIES_REG) & PCIE_CAP_MAX_LINK_SPEED_MASK);
+	if ((cap != 0U) && (cap < target)) {
+		target = cap;
+	}
+	cap = tegrabl_pcie_ep_max_speed(ctrl_num);
+	if ((cap != 0U) && (cap < target)) {
+		target = cap;
+	}
+	pr_debug("PCIe controller-%u: target link speed gen%u\n", ctrl_num, target);
+
+	for (;;) {
+		if (tegrabl_pcie_wait_for_l0(ctrl_num) && tegrabl_pcie_link_is_stable(ctrl_num)) {
+			val = pcie_dbi_read32(ctrl_num, PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG);
+			link->speed = (uint8_t)((val & PCIE_CAP_LINK_SPEED_MASK) >> PCIE_CAP_LINK_SPEED_SHIFT);
+			link->width = (uint8_t)((val & PCIE_CAP_NEGO_LINK_WIDTH_MASK) >> PCIE_CAP_NEGO_LINK_WIDTH_SHIFT);
+			if ((link->speed >= target) || speed_change_requested) {
+				break;
+			}
+			/* Both ends support a higher speed, ask for it once */
+			speed_change_requested = true;
+			tegrabl_pcie_retrain_link(ctrl_num, target);
+			continue;
+		}
+
+		if (target <= 1U) {
+			pr_warn("PCIe controller-%u link is unstable at gen1\n", ctrl_num);
+			break;
+		}
+
+		target--;
+		link->retries++;
+		pr_warn("PCIe controller-%u link is unstable, retrying at gen%u\n", ctrl_num, target);
+		tegrabl_pcie_retrain_link(ctrl_num, target);
+	}
+
+	pr_info("PCIe controller-%u link: gen%u x%u, %u retries\n", ctrl_num, link->speed, link->width,
+			link->retries);
+	val = link->speed | ((uint32_t)link->width << 8) | ((uint32_t)link->retries << 16);
+	(void)tegrabl_snprintf(profiler_str, sizeof(profiler_str), "PCIe C%u gen%u x%u r%u", ctrl_num, link->speed,
+						   link->width, link->retries);
+	tegrabl_profiler_record(profiler_str, 0, DETAILED);
+	tegrabl_pcie_tlm_record(ctrl_num, PCIE_TLM_LINK, val);
+
+	return tegrabl_pcie_is_linkup(ctrl_num) ? TEGRABL_NO_ERROR : TEGRABL_ERR_INIT_FAILED;
+}
+
+/**
+ * @brief Bring up the links of a set of PCIe controllers together
+ *
+ * All the controllers are programmed first, PERST# is then held asserted for
+ * a single window shared by all of them, and their link-up status is polled
+ * in one loop. Probing N controllers hence costs one training window instead
+ * of N. Each link which comes up is then brought to the highest speed it is
+ * stable at.
+ *
+ * @param[in] ctrl_nums controllers to be initialized
+ * @param[in] num_ctrls number of entries in ctrl_nums
+ * @param[in] link_speed target link speed
+ * @param[out] results per controller status, TEGRABL_NO_ERROR if the link of
+ *             ctrl_nums[i] is up. Controllers which failed are reset.
+ *
+ * @return TEGRABL_NO_ERROR if at least one link is up, TEGRABL_ERR_INIT_FAILED
+ *         if none is, TEGRABL_ERR_INVALID on invalid arguments
+ */
+tegrabl_error_t tegrabl_pcie_soc_init_links(const uint8_t *ctrl_nums, uint8_t num_ctrls, uint8_t link_speed,
+											tegrabl_error_t *results)
+{
+	uint32_t perst_start[MAX_CTRL_SUPPORTED];
+	uint32_t started = 0;
+	uint32_t linked = 0;
+	uint32_t val;
+	uint8_t ctrl_num;
+	uint8_t i;
+
+	if ((ctrl_nums == NULL) || (results == NULL) || (num_ctrls == 0U)) {
+		return TEGRABL_ERROR(TEGRABL_ERR_INVALID, 0);
+	}
+
+	for (i = 0; i < num_ctrls; i++) {
+		ctrl_num = ctrl_nums[i];
+		if ((ctrl_num >= max_ctrl_supported) || ((started & BIT(ctrl_num)) != 0U)) {
+			pr_error("%s: invalid or duplicate controller %u\n", __func__, ctrl_num);
+			results[i] = TEGRABL_ERROR(TEGRABL_ERR_INVALID, 1);
+			continue;
+		}
+
+		results[i] = tegrabl_pcie_soc_setup_ctrl(ctrl_num, link_speed);
+		if (results[i] != TEGRABL_NO_ERROR) {
+			tegrabl_pcie_reset_state(ctrl_num);
+			continue;
+		}
+		perst_start[ctrl_num] = tegrabl_get_timestamp_us();
+		started |= BIT(ctrl_num);
+	}
+
+	if (started == 0U) {
+		return TEGRABL_ERR_INIT_FAILED;
+	}
+
+	/* Single PERST# window for all the controllers */
 	tegrabl_udelay(100000U);
 
 	/** Assert PEX_RST signal to endpoint */
-	val = pcie_appl_read32(ctrl_num, APPL_PINMUX);
-	val |= APPL_PINMUX_PEX_RST;	/* APPL_PINMUX_PEX_RST to 1 */
-	pcie_appl_write32(ctrl_num, APPL_PINMUX, val);
+	for (ctrl_num = 0; ctrl_num < max_ctrl_supported; ctrl_num++) {
+		if ((started & BIT(ctrl_num)) != 0U) {
+			val = pcie_appl_read32(ctrl_num, APPL_PINMUX);
+			val |= APPL_PINMUX_PEX_RST;	/* APPL_PINMUX_PEX_RST to 1 */
+			pcie_appl_write32(ctrl_num, APPL_PINMUX, val);
+			tegrabl_pcie_tlm_record(ctrl_num, PCIE_TLM_PERST, tegrabl_get_timestamp_us() - perst_start[ctrl_num]);
+			tegrabl_pcie_tlm_start_training(ctrl_num);
+		}
+	}
 
 	tegrabl_udelay(1U);
 
 	/** Start LTSSM from RP side */
-	val = pcie_appl_read32(ctrl_num, APPL_CTRL);
-	val |= APPL_CTRL_LTSSM_EN;
-	pcie_appl_write32(ctrl_num, APPL_CTRL, val);
+	for (ctrl_num = 0; ctrl_num < max_ctrl_supported; ctrl_num++) {
+		if ((started & BIT(ctrl_num)) != 0U) {
+			val = pcie_appl_read32(ctrl_num, APPL_CTRL);
+			val |= APPL_CTRL_LTSSM_EN;
+			pcie_appl_write32(ctrl_num, APPL_CTRL, val);
+		}
+	}
 
 	/** Poll for PCIe link up */
-	error = tegra_reg_poll_mask(appl_reg_offset[ctrl_num] + APPL_LINK_STATUS, RDLH_LINK_UP_MASK,
-								RDLH_LINK_UP, 1000000);
-	if (error != TEGRABL_NO_ERROR) {
-		pr_critical("Failed to link up controller-%d\n", ctrl_num);
-		error = TEGRABL_ERR_INIT_FAILED;
-		goto fail;
+	linked = tegrabl_pcie_soc_wait_for_links(started, LINK_UP_TIMEOUT_US);
+
+	for (ctrl_num = 0; ctrl_num < max_ctrl_supported; ctrl_num++) {
+		if (((linked & BIT(ctrl_num)) != 0U) && (tegrabl_pcie_soc_negotiate_speed(ctrl_num) != TEGRABL_NO_ERROR)) {
+			linked &= ~BIT(ctrl_num);
+		}
 	}
-	pr_info("PCIe controller-%d link is up\n", ctrl_num);
 
-fail:
-	if (error != TEGRABL_NO_ERROR) {
+	for (i = 0; i < num_ctrls; i++) {
+		ctrl_num = ctrl_nums[i];
+		if ((results[i] != TEGRABL_NO_ERROR) || ((linked & BIT(ctrl_num)) != 0U)) {
+			continue;
+		}
+		pr_critical("Failed to link up controller-%d\n", ctrl_num);
+		results[i] = TEGRABL_ERR_INIT_FAILED;
 		tegrabl_pcie_reset_state(ctrl_num);
 	}
-	return error;
+
+	return (linked != 0U) ? TEGRABL_NO_ERROR : TEGRABL_ERR_INIT_FAILED;
 }
 
+tegrabl_error_t tegrabl_pcie_soc_init(uint8_t ctrl_num, uint8_t link_speed)
+{
+	tegrabl_error_t result = TEGRABL_NO_ERROR;
+
+	if (tegrabl_pcie_is_discovered(ctrl_num)) {
+		pr_info("PCIe controller-%u link is up since discovery\n", ctrl_num);
+#if defined(CONFIG_ENABLE_NVME_BOOT)
+		pcie_discovered &= (uint8_t)~BIT(ctrl_num);
+#endif
+	} else {
+		(void)tegrabl_pcie_soc_init_links(&ctrl_num, 1U, link_speed, &result);
+	}
+
+#if defined(CONFIG_ENABLE_NVME_BOOT) && defined(CONFIG_ENABLE_PCIE_LINK_HANDOFF)
+	/* The kernel boots from the drive behind this link, let it reuse the trained link */
+	if ((result == TEGRABL_NO_ERROR) && ((pcie_boot_ctrls & BIT(ctrl_num)) != 0U)) {
+		(void)tegrabl_pcie_soc_keep_link(ctrl_num);
+	}
+#endif
+
+	return result;
+}
+
+#if defined(CONFIG_ENABLE_PCIE_LINK_HANDOFF)
+/**
+ * @brief BAR assigned by the bootloader to a function behind a kept link
+ */
+struct tegrabl_pcie_handoff_bar {
+	uint32_t bdf;
+	uint32_t bar;
+	uint64_t addr;
+	uint64_t size;
+};
+
+/* Controllers whose link is left trained for the kernel */
+static uint32_t pcie_handoff_mask;
+static struct tegrabl_pcie_handoff_bar pcie_handoff_bars[MAX_CTRL_SUPPORTED][PCIE_MAX_HANDOFF_BARS];
+static uint8_t pcie_handoff_num_bars[MAX_CTRL_SUPPORTED];
+
+/**
+ * @brief Leave the link of a controller powered and trained at handoff
+ *
+ * PME turnoff, powergating and regulator disabling of the controller are
+ * skipped from then on, and its link state is published in the kernel DT
+ * (see tegrabl_pcie_add_handoff_info).
+ *
+ * @param[in] ctrl_num controller number
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_INVALID if the link is not up
+ */
+tegrabl_error_t tegrabl_pcie_soc_keep_link(uint8_t ctrl_num)
+{
+	if ((ctrl_num >= max_ctrl_supported) || !tegrabl_pcie_is_linkup(ctrl_num)) {
+		return TEGRABL_ERR_INVALID;
+	}
+
+	pr_info("PCIe controller-%u link is kept up for the kernel\n", ctrl_num);
+	pcie_handoff_mask |= BIT(ctrl_num);
+	pcie_handoff_num_bars[ctrl_num] = 0;
+
+	return TEGRABL_NO_ERROR;
+}
+
+/**
+ * @brief Record a BAR assigned behind a kept link, to be published in the kernel DT
+ *
+ * @param[in] ctrl_num controller number
+ * @param[in] bdf bus/device/function of the owner of the BAR
+ * @param[in] bar BAR index
+ * @param[in] addr address assigned to the BAR
+ * @param[in] size size of the BAR
+ *
+ * @return TEGRABL_NO_ERROR if successful, appropriate error otherwise
+ */
+tegrabl_error_t tegrabl_pcie_soc_record_bar(uint8_t ctrl_num, uint32_t bdf, uint32_t bar, uint64_t addr,
+											uint64_t size)
+{
+	struct tegrabl_pcie_handoff_bar *entry;
+
+	if ((ctrl_num >= max_ctrl_supported) || ((pcie_handoff_mask & BIT(ctrl_num)) == 0U)) {
+		return TEGRABL_ERR_INVALID;
+	}
+
+	if (pcie_handoff_num_bars[ctrl_num] >= PCIE_MAX_HANDOFF_BARS) {
+		pr_error("%s: too many BARs on controller-%u\n", __func__, ctrl_num);
+		return TEGRABL_ERR_NO_MEMORY;
+	}
+
+	entry = &pcie_handoff_bars[ctrl_num][pcie_handoff_num_bars[ctrl_num]];
+	entry->bdf = bdf;
+	entry->bar = bar;
+	entry->addr = addr;
+	entry->size = size;
+	pcie_handoff_num_bars[ctrl_num]++;
+
+	return TEGRABL_NO_ERROR;
+}
+
+static bool tegrabl_pcie_link_is_kept(uint8_t ctrl_num)
+{
+	return (pcie_handoff_mask & BIT(ctrl_num)) != 0U;
+}
+
+/*
+ * Publish the state of a kept link in its controller node of the kernel DT.
+ *
+ * Binding (in the "nvidia,tegra194-pcie" node):
+ *   nvidia,bl-link-up;
+ *   nvidia,bl-link-speed = <gen>;
+ *   nvidia,bl-link-width = <lanes>;
+ *   nvidia,bl-bars = <bdf bar addr-hi addr-lo size-hi size-lo>, ...;
+ *
+ * Properties are only present if the bootloader left the link trained in L0,
+ * in which case the OS may skip PERST# and link training. nvidia,bl-bars is
+ * absent if no BAR has been assigned.
+ */
+static tegrabl_error_t tegrabl_pcie_add_handoff_info(void *fdt, int32_t node_offset, uint8_t ctrl_num)
+{
+	struct tegrabl_pcie_handoff_bar *entry;
+	uint32_t buf[PCIE_MAX_HANDOFF_BARS * 6U];
+	uint32_t i;
+	int dterr;
+
+	if (!tegrabl_pcie_link_is_kept(ctrl_num)) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	if (!tegrabl_pcie_is_linkup(ctrl_num)) {
+		pr_warn("PCIe controller-%u link went down, not handed off\n", ctrl_num);
+		return TEGRABL_NO_ERROR;
+	}
+
+	dterr = fdt_setprop(fdt, node_offset, "nvidia,bl-link-up", NULL, 0);
+	if (dterr >= 0) {
+		dterr = fdt_setprop_u32(fdt, node_offset, "nvidia,bl-link-speed", pcie_link_state[ctrl_num].speed);
+	}
+	if (dterr >= 0) {
+		dterr = fdt_setprop_u32(fdt, node_offset, "nvidia,bl-link-width", pcie_link_state[ctrl_num].width);
+	}
+	if ((dterr >= 0) && (pcie_handoff_num_bars[ctrl_num] != 0U)) {
+		for (i = 0; i < pcie_handoff_num_bars[ctrl_num]; i++) {
+			entry = &pcie_handoff_bars[ctrl_num][i];
+			buf[(6U * i) + 0U] = cpu_to_fdt32(entry->bdf);
+			buf[(6U * i) + 1U] = cpu_to_fdt32(entry->bar);
+			buf[(6U * i) + 2U] = cpu_to_fdt32((uint32_t)(entry->addr >> 32));
+			buf[(6U * i) + 3U] = cpu_to_fdt32((uint32_t)entry->addr);
+			buf[(6U * i) + 4U] = cpu_to_fdt32((uint32_t)(entry->size >> 32));
+			buf[(6U * i) + 5U] = cpu_to_fdt32((uint32_t)entry->size);
+		}
+		dterr = fdt_setprop(fdt, node_offset, "nvidia,bl-bars", buf,
+							pcie_handoff_num_bars[ctrl_num] * 6U * sizeof(uint32_t));
+	}
+
+	if (dterr < 0) {
+		pr_error("%s: failed to publish controller-%u link state (%s)\n", __func__, ctrl_num,
+				 fdt_strerror(dterr));
+		return TEGRABL_ERR_ADD_FAILED;
+	}
+
+	pr_info("PCIe controller-%u link state handed off: gen%u x%u\n", ctrl_num, pcie_link_state[ctrl_num].speed,
+			pcie_link_state[ctrl_num].width);
+	return TEGRABL_NO_ERROR;
+}
+#else
+static bool tegrabl_pcie_link_is_kept(uint8_t ctrl_num)
+{
+	(void)ctrl_num;
+	return false;
+}
+#endif /* CONFIG_ENABLE_PCIE_LINK_HANDOFF */
+
+#if defined(CONFIG_ENABLE_PCIE_LINK_HANDOFF) || defined(CONFIG_ENABLE_PCIE_TELEMETRY)
+/**
+ * @brief Publish the bootloader side state of a controller in its kernel DT node
+ *
+ * @param[in] fdt kernel DT
+ * @param[in] node_offset offset of a "nvidia,tegra194-pcie" node
+ *
+ * @return TEGRABL_NO_ERROR if successful, appropriate error otherwise
+ */
+tegrabl_error_t tegrabl_pcie_soc_update_kernel_dt(void *fdt, int32_t node_offset)
+{
+	tegrabl_error_t err = TEGRABL_NO_ERROR;
+	uintptr_t pcie_addr;
+	uint8_t ctrl_num;
+
+	if (tegrabl_dt_read_reg_by_index(fdt, node_offset, 0, &pcie_addr, NULL) != TEGRABL_NO_ERROR) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	for (ctrl_num = 0; ctrl_num < max_ctrl_supported; ctrl_num++) {
+		if (pcie_addr == appl_reg_offset[ctrl_num]) {
+			break;
+		}
+	}
+	if (ctrl_num >= max_ctrl_supported) {
+		return TEGRABL_NO_ERROR;
+	}
+
+#if defined(CONFIG_ENABLE_PCIE_LINK_HANDOFF)
+	err = tegrabl_pcie_add_handoff_info(fdt, node_offset, ctrl_num);
+#endif
+#if defined(CONFIG_ENABLE_PCIE_TELEMETRY)
+	if (err == TEGRABL_NO_ERROR) {
+		err = tegrabl_pcie_add_telemetry_info(fdt, node_offset, ctrl_num);
+	}
+#endif
+
+	return err;
+}
+#endif
+
 /**
  * @brief API to disable PCIe host controller link with the endpoint
  *
@@ -747,17 +1891,6 @@ tegrabl_error_t tegrabl_pcie_soc_disable_link(uint8_t ctrl_num)
 	return error;
 }
 
-static bool tegrabl_pcie_is_linkup(uint8_t ctrl_num)
-{
-	uint32_t val;
-
-	val = pcie_appl_read32(ctrl_num, APPL_LINK_STATUS);
-	if ((val & RDLH_LINK_UP_MASK) == RDLH_LINK_UP) {
-		return true;
-	}
-	return false;
-}
-
 static bool tegrabl_pcie_try_linkl2(uint8_t ctrl_num)
 {
 	uint32_t val;
@@ -782,6 +1915,11 @@ void tegrabl_pcie_soc_pme_turnoff(uint8_t ctrl_num)
 
 	pr_trace("%s(%u):\n", __func__, ctrl_num);
 
+	if (tegrabl_pcie_link_is_kept(ctrl_num)) {
+		pr_info("PCIe (%u) link is kept up for the kernel\n", ctrl_num);
+		return;
+	}
+
 	/* check linkup */
 	if (tegrabl_pcie_is_linkup(ctrl_num) == false) {
 		pr_info("PCIe (%u) Link is not UP\n", ctrl_num);
@@ -804,10 +1942,7 @@ void tegrabl_pcie_soc_pme_turnoff(uint8_t ctrl_num)
 
 		error = readl_poll_timeout(appl_reg_offset[ctrl_num] + APPL_DEBUG,
 						val,
-						((val & SMLH_LTSSM_STATE_MASK) == LTSSM_STATE_DETECT_QUIET) ||
-						((val & SMLH_LTSSM_STATE_MASK) == LTSSM_STATE_DETECT_ACT) ||
-						((val & SMLH_LTSSM_STATE_MASK) == LTSSM_STATE_PRE_DETECT_QUIET) ||
-						((val & SMLH_LTSSM_STATE_MASK) == LTSSM_STATE_DETECT_WAIT),
+						tegrabl_pcie_ltssm_in_detect(val & SMLH_LTSSM_STATE_MASK),
 						LTSSM_DELAY, LTSSM_TIMEOUT);
 
 		if (error)
@@ -837,26 +1972,26 @@ void tegrabl_pcie_soc_pme_turnoff(uint8_t ctrl_num)
 tegrabl_error_t tegrabl_pcie_soc_powergate(uint8_t ctrl_num)
 {
 	tegrabl_error_t error;
+	uint32_t domain_id;
 
 	pr_trace("%s: %u\n", __func__, ctrl_num);
-	switch (ctrl_num) {
-	case 0:
-		error = tegrabl_pcie_powergate(TEGRA194_POWER_DOMAIN_PCIEX8B);
-		break;
-	case 1:
-	case 2:
-	case 3:
-		error = tegrabl_pcie_powergate(TEGRA194_POWER_DOMAIN_PCIEX1A);
-		break;
-	case 4:
-		error = tegrabl_pcie_powergate(TEGRA194_POWER_DOMAIN_PCIEX4A);
-		break;
-	case 5:
-		error = tegrabl_pcie_powergate(TEGRA194_POWER_DOMAIN_PCIEX8A);
-		break;
-	default:
+
+	if (tegrabl_pcie_link_is_kept(ctrl_num)) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	domain_id = tegrabl_car_get_pg_id(TEGRABL_MODULE_PCIE_CORE, ctrl_num);
+	if (domain_id == TEGRABL_PG_ID_NONE) {
 		error = TEGRABL_ERR_INVALID;
-		break;
+	} else if ((pcie_pg_held & BIT(ctrl_num)) != 0U) {
+		pcie_pg_held &= (uint8_t)~BIT(ctrl_num);
+		error = tegrabl_pcie_powergate(domain_id);
+	} else if (tegrabl_pg_refcount(domain_id) == 0U) {
+		/* Not powered on through preinit, force the partition off */
+		error = tegrabl_pcie_powergate(domain_id);
+	} else {
+		/* Partition is in use by another controller */
+		error = TEGRABL_NO_ERROR;
 	}
 
 	if (error != TEGRABL_NO_ERROR) {
@@ -866,165 +2001,237 @@ tegrabl_error_t tegrabl_pcie_soc_powergate(uint8_t ctrl_num)
 	return error;
 }
 
+/* Find the entry of a supply in pcie_supplies[], allocating one if needed */
+static struct tegrabl_pcie_supply *tegrabl_pcie_get_supply(int32_t phandle)
+{
+	struct tegrabl_pcie_supply *free_entry = NULL;
+	uint32_t i;
+
+	for (i = 0; i < ARRAY_SIZE(pcie_supplies); i++) {
+		if (pcie_supplies[i].phandle == phandle) {
+			return &pcie_supplies[i];
+		}
+		if ((free_entry == NULL) && (pcie_supplies[i].phandle == 0)) {
+			free_entry = &pcie_supplies[i];
+		}
+	}
+
+	if (free_entry != NULL) {
+		free_entry->phandle = phandle;
+		free_entry->ctrl_mask = 0;
+	}
+	return free_entry;
+}
+
 /**
- * @brief Perform enabling regulators for certain PCIe controller
+ * @brief Turn on the supplies (or platform GPIOs) of a controller without
+ * waiting for them to settle
  *
- * Scan device tree for regulators (in pcie_regulator_names[]) of the specified controller.
- * If regulator name is found in the device tree, enable the specified regulator.
+ * A supply already turned on for another controller is only accounted to
+ * this one as well, it is not programmed nor ramped again.
  *
- * @param[in] ctrl_num specifies the controller number whose regulators to be enabled
+ * @param[in] ctrl_num controller number
+ * @param[in] desc descriptor of the controller
+ * @param[in,out] ramp_us largest ramp time of the supplies turned on so far
  *
  * @return TEGRABL_NO_ERROR if successful, appropriate error otherwise
  */
-tegrabl_error_t tegrabl_pcie_enable_regulators(uint8_t ctrl_num)
+static tegrabl_error_t tegrabl_pcie_start_supplies(uint8_t ctrl_num, struct tegrabl_pcie_ctrl_desc *desc,
+												   uint32_t *ramp_us)
 {
 	tegrabl_error_t err = TEGRABL_NO_ERROR;
-	void *fdt;
-	const uint32_t *temp;
-	int32_t node_offset = 0;
-	int32_t reg_node_offset = 0;
+	struct tegrabl_pcie_supply *supply;
+	struct gpio_driver *gpio_drv = NULL;
+	uint32_t gpio_chip_id;
+	uint8_t state;
 	uint32_t i;
-	uint32_t reg_voltage = 0;
-	int32_t reg_phandle;
-	uint8_t index = 0;
-	bool found_regulator = false;
 
-	err = tegrabl_dt_get_fdt_handle(TEGRABL_DT_BL, &fdt);
-	if (TEGRABL_NO_ERROR != err) {
-		pr_error("%s: failed to get DT_BL; error=0x%x\n", __func__, err);
-		goto fail;
-	}
-
-	err = tegrabl_locate_pcie_ctrl_in_dt(fdt, ctrl_num, &node_offset);
-	if (err != TEGRABL_NO_ERROR) {
-		/* if error is returned, treat it as no regulators to be enabled */
-		pr_warn("%s: no pcie controller node found in DT\n", __func__);
-		err = TEGRABL_NO_ERROR;
-		goto fail;
-	}
+	/* It is not an error if no regulator is found. */
+	for (i = 0; i < desc->num_supplies; i++) {
+		if (desc->supply_uv[i] == 0U) {
+			err = TEGRABL_ERR_NOT_FOUND;
+			pr_error("%s: regulator voltage not specified; error=0x%x\n", __func__, err);
+			goto fail;
+		}
 
-	/* parse all supply names. It is not an error if no regulator is found. */
-	for (i = 0; i < ARRAY_SIZE(pcie_regulator_names); i++) {
-		reg_phandle = 0;
-		temp = fdt_getprop(fdt, node_offset, pcie_regulator_names[i], NULL);
+		supply = tegrabl_pcie_get_supply(desc->supply_phandle[i]);
+		if (supply == NULL) {
+			err = TEGRABL_ERR_NO_MEMORY;
+			pr_error("%s: too many pcie supplies\n", __func__);
+			goto fail;
+		}
 
-		if (temp != NULL) {
-			reg_phandle = fdt32_to_cpu(*temp);
-			pr_info("i=%u, reg_phandle=0x%x\n", i, reg_phandle);
-		} else {
-			pr_info("%s not found\n", pcie_regulator_names[i]);
+		if (supply->ctrl_mask != 0U) {
+			pr_info("%s: regulator 0x%x already on\n", __func__, supply->phandle);
+			supply->ctrl_mask |= BIT(ctrl_num);
 			continue;
 		}
 
-		if (reg_phandle) {
-			reg_node_offset = fdt_node_offset_by_phandle(fdt, reg_phandle);
-			temp = fdt_getprop(fdt, reg_node_offset, PROPERTY_VOLTAGE, NULL);
-			if (temp != NULL) {
-				reg_voltage = fdt32_to_cpu(*temp);
-				pr_info("reg_voltage=%u\n", reg_voltage);
-			} else {
-				err = TEGRABL_ERR_NOT_FOUND;
-				pr_error("%s: regulator voltage not specified; error=0x%x\n", __func__, err);
-				goto fail;
-			}
-
-			pr_info("%s: regulator_set_voltage(0x%x, %u)\n", __func__, reg_phandle, reg_voltage);
-			err = tegrabl_regulator_set_voltage(reg_phandle, reg_voltage, STANDARD_VOLTS);
-			if (err != TEGRABL_NO_ERROR) {
-				pr_error("%s: failed tegrabl_regulator_set_voltage(0x%x, %u)\n", __func__,
-						 reg_phandle, reg_voltage);
-				goto fail;
-			}
-			pcie_ctrl_regulator_handles[ctrl_num][index] = reg_phandle;
-			++index;
-			found_regulator = true;
+		pr_info("%s: regulator_set_voltage(0x%x, %u)\n", __func__, desc->supply_phandle[i], desc->supply_uv[i]);
+		err = tegrabl_regulator_set_voltage(desc->supply_phandle[i], desc->supply_uv[i], STANDARD_VOLTS);
+		if (err != TEGRABL_NO_ERROR) {
+			pr_error("%s: failed tegrabl_regulator_set_voltage(0x%x, %u)\n", __func__,
+					 desc->supply_phandle[i], desc->supply_uv[i]);
+			goto fail;
 		}
+		supply->ctrl_mask |= BIT(ctrl_num);
+		*ramp_us = MAX(*ramp_us, desc->supply_ramp_us[i]);
 	}
 
-	/* If DT has no pcie_regulator_names, try to look for "nvidia,plat-gpios" */
-	if (!found_regulator) {
-		uint32_t n_gpios = 0;
-		uint32_t gpio_chip_id;
-		uint8_t state;
-		struct gpio_driver *gpio_drv = NULL;
-		uint32_t gpio_phandle, gpio_pin, gpio_polarity;
-
-		pr_trace("Trying to get %s:\n", PROPERTY_PLAT_GPIOS);
-
-		err = tegrabl_dt_count_elems_of_size(fdt, node_offset, PROPERTY_PLAT_GPIOS, 3, &n_gpios);
-		pr_debug("err=0x%x, n_gpios=%u\n", err, n_gpios);
-		n_gpios /= sizeof(uint32_t);
+	/* Without regulators, drive the "nvidia,plat-gpios" instead */
+	for (i = 0; i < desc->num_gpios; i++) {
+		pr_info("gpio phandle=0x%x, pin=0x%x, polarity=0x%x\n", desc->gpios[i].phandle, desc->gpios[i].pin,
+				desc->gpios[i].polarity);
+
+		err = tegrabl_gpio_get_chipid_with_phandle(desc->gpios[i].phandle, &gpio_chip_id);
 		if (err != TEGRABL_NO_ERROR) {
-			pr_warn("Failed to get nvidia,plat-gpios\n");
-			/* not really an error */
-			err = TEGRABL_NO_ERROR;
+			pr_error("Failed to get chip id from gpio_phandle\n");
 			goto fail;
 		}
-
-		temp = fdt_getprop(fdt, node_offset, PROPERTY_PLAT_GPIOS, NULL);
-		if (!temp) {
-			pr_error("Failed to get %s property\n", PROPERTY_PLAT_GPIOS);
-			err = TEGRABL_ERR_NOT_FOUND;
+		err = tegrabl_gpio_driver_get(gpio_chip_id, &gpio_drv);
+		if (err != TEGRABL_NO_ERROR) {
+			pr_error("Failed to get gpio driver handle\n");
+			goto fail;
+		}
+		err = gpio_config(gpio_drv, desc->gpios[i].pin, GPIO_PINMODE_OUTPUT);
+		if (err != TEGRABL_NO_ERROR) {
+			pr_error("Failed to configure gpio mode\n");
 			goto fail;
 		}
+		state = GPIO_PIN_STATE_HIGH ^ desc->gpios[i].polarity;
+		err = gpio_write(gpio_drv, desc->gpios[i].pin, state);
+		if (err != TEGRABL_NO_ERROR) {
+			pr_error("Failed to write gpio (0x%x) state to %u\n", desc->gpios[i].pin, state);
+			goto fail;
+		}
+	}
 
-		while (n_gpios) {
-			gpio_phandle = fdt32_to_cpu(*temp);
-			gpio_pin = fdt32_to_cpu(*(temp+1));
-			gpio_polarity = fdt32_to_cpu(*(temp+2));
-			pr_info("gpio phandle=0x%x, pin=0x%x, polarity=0x%x\n", gpio_phandle, gpio_pin, gpio_polarity);
+fail:
+	return err;
+}
 
-			err = tegrabl_gpio_get_chipid_with_phandle(gpio_phandle, &gpio_chip_id);
-			if (err != TEGRABL_NO_ERROR) {
-				pr_error("Failed to get chip id from gpio_phandle\n");
-				goto fail;
-			}
-			err = tegrabl_gpio_driver_get(gpio_chip_id, &gpio_drv);
-			if (err != TEGRABL_NO_ERROR) {
-				pr_error("Failed to get gpio driver handle\n");
-				goto fail;
-			}
-			err = gpio_config(gpio_drv, gpio_pin, GPIO_PINMODE_OUTPUT);
-			if (err != TEGRABL_NO_ERROR) {
-				pr_error("Failed to configure gpio mode\n");
-				goto fail;
-			}
-			state = GPIO_PIN_STATE_HIGH ^ gpio_polarity;
-			err = gpio_write(gpio_drv, gpio_pin, state);
-			if (err != TEGRABL_NO_ERROR) {
-				pr_error("Failed to write gpio (0x%x) state to %u\n", gpio_pin, state);
-				goto fail;
-			}
+/**
+ * @brief Enable the regulators of a set of PCIe controllers together
+ *
+ * All the supplies of all the controllers are turned on back to back, each
+ * shared supply only once, and a single wait covers the largest
+ * "regulator-enable-ramp-delay" among them.
+ *
+ * @param[in] ctrl_nums controllers whose regulators are to be enabled
+ * @param[in] num_ctrls number of entries in ctrl_nums
+ *
+ * @return TEGRABL_NO_ERROR if successful, appropriate error otherwise
+ */
+tegrabl_error_t tegrabl_pcie_enable_regulators_batch(const uint8_t *ctrl_nums, uint8_t num_ctrls)
+{
+	tegrabl_error_t err = TEGRABL_NO_ERROR;
+	struct tegrabl_pcie_ctrl_desc *desc;
+	const uint32_t start = tegrabl_get_timestamp_us();
+	uint32_t ramp_us = 0;
+	uint8_t i;
 
-			temp += 3;
-			--n_gpios;
+	for (i = 0; i < num_ctrls; i++) {
+		err = tegrabl_pcie_get_ctrl_desc(ctrl_nums[i], &desc);
+		if (err != TEGRABL_NO_ERROR) {
+			goto fail;
+		}
+
+		if (!desc->is_present) {
+			/* treat it as no regulators to be enabled */
+			pr_warn("%s: no pcie controller node found in DT\n", __func__);
+			continue;
+		}
+
+		err = tegrabl_pcie_start_supplies(ctrl_nums[i], desc, &ramp_us);
+		if (err != TEGRABL_NO_ERROR) {
+			goto fail;
 		}
 	}
 
 fail:
+	/* Let whatever has been turned on settle, even on failure */
+	if (ramp_us != 0U) {
+		pr_info("%s: waiting %u us for supplies to ramp\n", __func__, ramp_us);
+		tegrabl_udelay(ramp_us);
+	}
+
+	for (i = 0; i < num_ctrls; i++) {
+		if (ctrl_nums[i] < max_ctrl_supported) {
+			tegrabl_pcie_tlm_record(ctrl_nums[i], PCIE_TLM_REGULATORS, tegrabl_get_timestamp_us() - start);
+		}
+	}
 	return err;
 }
 
+/**
+ * @brief Perform enabling regulators for certain PCIe controller
+ *
+ * Scan device tree for regulators (in pcie_regulator_names[]) of the specified controller.
+ * If regulator name is found in the device tree, enable the specified regulator.
+ *
+ * @param[in] ctrl_num specifies the controller number whose regulators to be enabled
+ *
+ * @return TEGRABL_NO_ERROR if successful, appropriate error otherwise
+ */
+tegrabl_error_t tegrabl_pcie_enable_regulators(uint8_t ctrl_num)
+{
+	return tegrabl_pcie_enable_regulators_batch(&ctrl_num, 1U);
+}
+
 /**
  * @brief Perform disabling regulators for certain PCIe controller
  *
+ * Supplies shared with other controllers stay on until all of them are done.
+ *
  * @param[in] ctrl_num specifies the controller number whose regulators to be disabled
 */
 void tegrabl_pcie_disable_regulators(uint8_t ctrl_num)
 {
-	uint8_t i;
-	int32_t reg_handle;
+	struct tegrabl_pcie_supply *supply;
+	uint32_t i;
+
+	if (tegrabl_pcie_link_is_kept(ctrl_num)) {
+		return;
+	}
 
-	for (i = 0; i < 2; ++i) {
-		reg_handle = pcie_ctrl_regulator_handles[ctrl_num][i];
-		if (reg_handle) {
-			pr_info("%s: disable regulator 0x%x\n", __func__, reg_handle);
-			tegrabl_regulator_disable(reg_handle);
+	for (i = 0; i < ARRAY_SIZE(pcie_supplies); ++i) {
+		supply = &pcie_supplies[i];
+		if ((supply->ctrl_mask & BIT(ctrl_num)) == 0U) {
+			continue;
+		}
+		supply->ctrl_mask &= ~BIT(ctrl_num);
+		if (supply->ctrl_mask == 0U) {
+			pr_info("%s: disable regulator 0x%x\n", __func__, supply->phandle);
+			tegrabl_regulator_disable(supply->phandle);
 		}
 	}
 }
 
 #if defined(CONFIG_ENABLE_NVME_BOOT)
+/* Speed the candidates are trained at by discovery, capped by "max-link-speed" of each */
+#define PCIE_DISCOVER_LINK_SPEED	4U
+
+/* Discovery probe accepting a controller only if the device behind it is an NVMe controller */
+static tegrabl_error_t tegrabl_pcie_probe_nvme_class(uint8_t ctrl_num, void *priv)
+{
+	struct tegrabl_pcie_ep_cfg_ctx ctx;
+	uint32_t cfg;
+	uint32_t class;
+
+	TEGRABL_UNUSED(priv);
+
+	cfg = tegrabl_pcie_ep_cfg_map(ctrl_num, &ctx);
+	class = NV_READ32(cfg + PCI_CLASS_REVISION_REG) >> PCI_CLASS_SHIFT;
+	tegrabl_pcie_ep_cfg_unmap(ctrl_num, &ctx);
+
+	if (class != PCI_CLASS_NVME) {
+		pr_info("PCIe controller-%u: device class 0x%06x is not NVMe\n", ctrl_num, class);
+		return TEGRABL_ERR_NOT_SUPPORTED;
+	}
+
+	return TEGRABL_NO_ERROR;
+}
+
 /*
  * tegrabl_get_pcie_ctrl_nums() function returns a list of pcie controller numbers based
  * on the original boot_dev:
@@ -1033,11 +2240,14 @@ void tegrabl_pcie_disable_regulators(uint8_t ctrl_num)
  *
  * original boot_dev		list of ctrl_nums
  * -----------------		-----------------------------------
- *   "nvme"					0, 1, . . , max_ctrl_supported-1 (to probe all PCIe controllers)
+ *   "nvme"					n (the NVMe controller selected by tegrabl_pcie_soc_discover
+ *							among all PCIe controllers, -1 if none)
  *   "nvme:C<n>"			n (to probe just PCIe controller Cn)
  *   "nvme:pcie@<addr>"		n (to probe a PCIe controller n which has the PCI address of <addr>)
  *
- * The returned list is terminated with -1.
+ * The returned list is terminated with -1. The controllers returned have their link
+ * kept for the kernel with CONFIG_ENABLE_PCIE_LINK_HANDOFF, once tegrabl_pcie_soc_init
+ * has brought it up.
 */
 
 int8_t *tegrabl_get_pcie_ctrl_nums(char *boot_dev)
@@ -1048,6 +2258,7 @@ int8_t *tegrabl_get_pcie_ctrl_nums(char *boot_dev)
 	char *hdr;
 	uintptr_t pcie_addr;
 	int8_t ctrl_num;
+	int8_t all_ctrls[MAX_CTRL_SUPPORTED + 1];
 
 	/*
 	 * Parse boot_dev string, it could be in the following format:
@@ -1062,17 +2273,18 @@ int8_t *tegrabl_get_pcie_ctrl_nums(char *boot_dev)
 
 	switch (boot_dev[0]) {
 	case '\0':
-		/* This is the bare nvme case: probe all controllers */
-		p_pcie_ctrl_nums = (int8_t *)tegrabl_calloc(sizeof(int8_t), max_ctrl_supported + 1);
-		if (p_pcie_ctrl_nums == NULL) {
-			pr_error("%s: memory allocation (%u) failed\n", __func__, max_ctrl_supported + 1);
-			return NULL;
+		/* This is the bare nvme case: train all controllers together and pick the NVMe one */
+		for (ctrl_num = 0; ((uint8_t)ctrl_num < max_ctrl_supported) &&
+			 ((uint8_t)ctrl_num < MAX_CTRL_SUPPORTED); ++ctrl_num) {
+			all_ctrls[ctrl_num] = ctrl_num;
 		}
-		for (ctrl_num = 0; (uint8_t)ctrl_num < max_ctrl_supported; ++ctrl_num) {
-			*(p_pcie_ctrl_nums + ctrl_num) = ctrl_num;
+		all_ctrls[ctrl_num] = -1;
+		ctrl_num = tegrabl_pcie_soc_discover(all_ctrls, PCIE_DISCOVER_LINK_SPEED, tegrabl_pcie_probe_nvme_class,
+											 NULL);
+		if (ctrl_num >= 0) {
+			pcie_discovered |= (uint8_t)BIT(ctrl_num);
 		}
-		*(p_pcie_ctrl_nums + ctrl_num) = -1;
-		return p_pcie_ctrl_nums;
+		break;
 	case ':':
 		/* This is either in "nvme:C<n>" or "nvme:pcie@<address>" case: */
 		++boot_dev;
@@ -1127,7 +2339,115 @@ int8_t *tegrabl_get_pcie_ctrl_nums(char *boot_dev)
 
 	*p_pcie_ctrl_nums = ctrl_num;
 	*(p_pcie_ctrl_nums + 1) = -1;
+	pcie_boot_ctrls = (ctrl_num >= 0) ? (uint8_t)BIT(ctrl_num) : 0U;
 
 	return p_pcie_ctrl_nums;
 }
+
+/**
+ * @brief Bring up all the candidate NVMe controllers together and select the
+ * one to boot from
+ *
+ * All the candidates are powered and trained in a single window. The ones
+ * whose link came up are then probed in order of their "nvidia,boot-priority"
+ * (lowest first, ties broken by their order in ctrl_nums), so the selection
+ * does not depend on which drive trains fastest. All the candidates but the
+ * selected one are then quiesced and powergated. The link of the selected
+ * one is left up.
+ *
+ * @param[in] ctrl_nums candidate controllers, terminated with -1
+ * @param[in] link_speed target link speed
+ * @param[in] probe function checking the device behind a trained controller
+ *            (e.g. NVMe identify), NULL to accept the first one
+ * @param[in] priv argument passed to probe
+ *
+ * @return selected controller number, -1 if none
+ */
+int8_t tegrabl_pcie_soc_discover(const int8_t *ctrl_nums, uint8_t link_speed, tegrabl_pcie_probe_fn_t probe,
+								 void *priv)
+{
+	struct tegrabl_pcie_ctrl_desc *desc;
+	tegrabl_error_t results[MAX_CTRL_SUPPORTED];
+	uint8_t cands[MAX_CTRL_SUPPORTED];
+	uint8_t order[MAX_CTRL_SUPPORTED];
+	uint8_t num_cands = 0;
+	uint8_t num_linked = 0;
+	int8_t selected = -1;
+	uint8_t ctrl_num;
+	uint8_t i, j;
+
+	if (ctrl_nums == NULL) {
+		return -1;
+	}
+
+	for (i = 0; (ctrl_nums[i] >= 0) && (num_cands < ARRAY_SIZE(cands)); i++) {
+		ctrl_num = (uint8_t)ctrl_nums[i];
+		if ((tegrabl_pcie_get_ctrl_desc(ctrl_num, &desc) == TEGRABL_NO_ERROR) && desc->is_available) {
+			cands[num_cands++] = ctrl_num;
+		}
+	}
+
+	/* Ramp the slot supplies of all the candidates at once */
+	if (tegrabl_pcie_enable_regulators_batch(cands, num_cands) != TEGRABL_NO_ERROR) {
+		pr_error("%s: failed to enable some regulators\n", __func__);
+	}
+
+	(void)tegrabl_pcie_soc_preinit_batch(cands, num_cands, results);
+	for (i = 0, j = 0; i < num_cands; i++) {
+		if (results[i] != TEGRABL_NO_ERROR) {
+			pr_error("%s: failed to preinit controller-%u\n", __func__, cands[i]);
+			tegrabl_pcie_disable_regulators(cands[i]);
+			(void)tegrabl_pcie_soc_powergate(cands[i]);
+			continue;
+		}
+		cands[j++] = cands[i];
+	}
+	num_cands = j;
+
+	if (num_cands == 0U) {
+		return -1;
+	}
+
+	(void)tegrabl_pcie_soc_init_links(cands, num_cands, link_speed, results);
+
+	/* Order the controllers which linked up by DT priority, insertion sort keeps ties in order */
+	for (i = 0; i < num_cands; i++) {
+		if (results[i] != TEGRABL_NO_ERROR) {
+			continue;
+		}
+		for (j = num_linked; (j > 0U) &&
+			 (pcie_ctrl_desc[order[j - 1U]].boot_priority > pcie_ctrl_desc[cands[i]].boot_priority); j--) {
+			order[j] = order[j - 1U];
+		}
+		order[j] = cands[i];
+		num_linked++;
+	}
+
+	for (i = 0; i < num_linked; i++) {
+		if ((probe == NULL) || (probe(order[i], priv) == TEGRABL_NO_ERROR)) {
+			selected = (int8_t)order[i];
+			break;
+		}
+		pr_warn("%s: controller-%u linked up but probe failed\n", __func__, order[i]);
+	}
+
+	/* Quiesce the others, a partition shared with the selected one stays referenced */
+	for (i = 0; i < num_cands; i++) {
+		ctrl_num = cands[i];
+		if ((int8_t)ctrl_num == selected) {
+			continue;
+		}
+		if (results[i] == TEGRABL_NO_ERROR) {
+			tegrabl_pcie_soc_pme_turnoff(ctrl_num);
+			tegrabl_pcie_reset_state(ctrl_num);
+		}
+		tegrabl_pcie_disable_regulators(ctrl_num);
+		(void)tegrabl_pcie_soc_powergate(ctrl_num);
+	}
+
+	if (selected >= 0) {
+		pr_info("%s: selected controller-%d\n", __func__, selected);
+	}
+	return selected;
+}
 #endif
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All Rights Reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property and
+ * proprietary rights in and to this software and related documentation. Any
+ * use, reproduction, disclosure or distribution of this software and related
+ * documentation without an express license agreement from NVIDIA Corporation
+ * is strictly prohibited.
+ */
+
+/**
+ * @file tegrabl_interval_set.h
+ *
+ * Sorted sets of address intervals, used to compute memory layouts
+ * (free DRAM, unscrubbed DRAM, ...) from lists of possibly overlapping regions.
+ */
+
+#ifndef TEGRABL_INTERVAL_SET_H
+#define TEGRABL_INTERVAL_SET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <tegrabl_error.h>
+
+/**
+ * @brief Half-open address interval [start, end)
+ */
+struct tegrabl_interval {
+	uint64_t start;
+	uint64_t end;
+};
+
+/**
+ * @brief Set of intervals backed by caller provided storage
+ *
+ * @param intervals Storage for the intervals
+ * @param count Number of valid intervals
+ * @param max_count Capacity of the storage
+ * @param is_normalized true if the intervals are sorted by start address and
+ *        none of them overlap or touch each other
+ */
+struct tegrabl_interval_set {
+	struct tegrabl_interval *intervals;
+	uint32_t count;
+	uint32_t max_count;
+	bool is_normalized;
+};
+
+/**
+ * @brief Initialize an empty interval set
+ *
+ * @param set Set to be initialized
+ * @param storage Storage for the intervals of the set
+ * @param max_count Number of intervals the storage can hold
+ */
+void tegrabl_interval_set_init(struct tegrabl_interval_set *set,
+							   struct tegrabl_interval *storage,
+							   uint32_t max_count);
+
+/**
+ * @brief Add a region to the set. The region may overlap with the regions
+ * already present, overlaps get merged on the next normalization.
+ *
+ * @param set Set to which region is to be added
+ * @param base Base address of the region
+ * @param size Size of the region, zero sized regions are ignored
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_TOO_SMALL if the set is
+ *         full, TEGRABL_ERR_INVALID if the region wraps around the address space
+ */
+tegrabl_error_t tegrabl_interval_set_add(struct tegrabl_interval_set *set,
+										 uint64_t base, uint64_t size);
+
+/**
+ * @brief Sort the intervals of the set by start address and merge the ones
+ * which overlap or touch each other. Takes O(n log n).
+ *
+ * @param set Set to be normalized
+ */
+void tegrabl_interval_set_normalize(struct tegrabl_interval_set *set);
+
+/**
+ * @brief Compute union of two sets (a | b)
+ *
+ * @param out Set which receives the result, must be different from a and b
+ * @param a First set
+ * @param b Second set
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_TOO_SMALL if out is
+ *         not large enough to hold the result
+ */
+tegrabl_error_t tegrabl_interval_set_union(struct tegrabl_interval_set *out,
+										   struct tegrabl_interval_set *a,
+										   struct tegrabl_interval_set *b);
+
+/**
+ * @brief Compute difference of two sets (a - b)
+ *
+ * @param out Set which receives the result, must be different from a and b
+ * @param a Set to subtract from
+ * @param b Set to be subtracted
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_TOO_SMALL if out is
+ *         not large enough to hold the result
+ */
+tegrabl_error_t tegrabl_interval_set_subtract(struct tegrabl_interval_set *out,
+											  struct tegrabl_interval_set *a,
+											  struct tegrabl_interval_set *b);
+
+/**
+ * @brief Compute intersection of two sets (a & b)
+ *
+ * @param out Set which receives the result, must be different from a and b
+ * @param a First set
+ * @param b Second set
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_TOO_SMALL if out is
+ *         not large enough to hold the result
+ */
+tegrabl_error_t tegrabl_interval_set_intersect(struct tegrabl_interval_set *out,
+											   struct tegrabl_interval_set *a,
+											   struct tegrabl_interval_set *b);
+
+/**
+ * @brief Align all the intervals of the set
+ *
+ * @param set Set to be aligned
+ * @param alignment Alignment, must be a power of 2
+ * @param shrink If true, intervals are shrunk to the aligned addresses they
+ *        contain (intervals smaller than alignment may vanish), else they are
+ *        grown to cover the aligned addresses around them.
+ */
+void tegrabl_interval_set_align(struct tegrabl_interval_set *set,
+								uint64_t alignment, bool shrink);
+
+#endif /* TEGRABL_INTERVAL_SET_H */
@@ -18,8 +18,28 @@
 #ifndef INCLUDE_TEGRABL_QUAL_ENGINE_H
 #define INCLUDE_TEGRABL_QUAL_ENGINE_H
 
+#include <stdint.h>
 #include <tegrabl_error.h>
 
+/**
+ * @brief Cumulative statistics of the regions scrubbed so far
+ *
+ * @param num_regions Number of regions scrubbed
+ * @param total_bytes Number of bytes scrubbed
+ * @param total_time_us Time from the start of each region until its
+ *        completion was noticed (upper bound of the HW time)
+ * @param timed_bytes Number of bytes of the regions whose completion was
+ *        noticed right away, which give the measured throughput
+ * @param timed_time_us Time spent by HW scrubbing the timed regions
+ */
+struct tegrabl_qual_engine_scrub_stats {
+	uint32_t num_regions;
+	uint64_t total_bytes;
+	uint64_t total_time_us;
+	uint64_t timed_bytes;
+	uint64_t timed_time_us;
+};
+
 /**
  * @brief Initialize/Scrub memory using MSS qual engine
  *
@@ -37,4 +57,58 @@ tegrabl_error_t tegrabl_sdram_qual_engine_init(uint64_t phy_addr_start, uint64_t
  */
 tegrabl_error_t tegrabl_sdram_qual_engine_wait_for_idle(void);
 
+/**
+ * @brief Get the scrub statistics. Start/end time and throughput of each
+ * region are also logged as it completes, and the completion of the timed
+ * regions is recorded in boot profiler.
+ *
+ * @param stats (output) Cumulative scrub statistics
+ */
+void tegrabl_sdram_qual_engine_get_stats(struct tegrabl_qual_engine_scrub_stats *stats);
+
+/**
+ * @brief Maximum number of regions which can be queued for scrubbing
+ */
+#define QUAL_ENGINE_MAX_QUEUED_REGIONS 64U
+
+/**
+ * @brief Queue a region for scrubbing and return without waiting.
+ * Queued regions are scrubbed in order; the engine is kicked right away if it
+ * is idle, and the following regions are started from
+ * tegrabl_sdram_qual_engine_poll().
+ *
+ * @param phy_addr_start Start address of the physical address range
+ * @param size Page-aligned memory size to scrub
+ *
+ * @return TEGRABL_NO_ERROR if successful, else appropriate error
+ */
+tegrabl_error_t tegrabl_sdram_qual_engine_queue_scrub(uint64_t phy_addr_start, uint64_t size);
+
+/**
+ * @brief Advance the scrub queue without blocking: if the engine is done with
+ * the current region, start the next queued one.
+ *
+ * @return TEGRABL_NO_ERROR if the queue is progressing, else error of the
+ *         failed region (sticky)
+ */
+tegrabl_error_t tegrabl_sdram_qual_engine_poll(void);
+
+/**
+ * @brief Wait until no queued region overlapping the given range is pending.
+ * Other regions may still be in progress on return.
+ *
+ * @param base Start address of the range
+ * @param size Size of the range
+ *
+ * @return TEGRABL_NO_ERROR if the range is scrubbed, else appropriate error
+ */
+tegrabl_error_t tegrabl_sdram_qual_engine_wait_for_range(uint64_t base, uint64_t size);
+
+/**
+ * @brief Wait until all the queued regions are scrubbed
+ *
+ * @return TEGRABL_NO_ERROR if all the regions are scrubbed, else appropriate error
+ */
+tegrabl_error_t tegrabl_sdram_qual_engine_wait_for_queue(void);
+
 #endif /* INCLUDE_TEGRABL_QUAL_ENGINE_H */
@@ -33,6 +33,26 @@ extern "C"
  */
 #define NUM_DRAM_BAD_PAGES 1024U
 
+/**
+ * Size of a DRAM page which gets blacklisted on ECC errors
+ */
+#define DRAM_BAD_PAGE_SIZE (64U * 1024U)
+
+#if defined(CONFIG_ENABLE_DRAM_BAD_PAGE_INFO)
+/**
+ * DRAM ECC page blacklisting information, located at
+ * dram_page_blacklist_info_address. Each entry holds the physical address of
+ * a bad page; list is terminated by a zero entry if it has less than
+ * NUM_DRAM_BAD_PAGES entries.
+ *
+ * This layout must match the one used by MB2, enable
+ * CONFIG_ENABLE_DRAM_BAD_PAGE_INFO only with an MB2 which produces it.
+ */
+struct tegrabl_dram_page_blacklist_info {
+	uint64_t page_addr[NUM_DRAM_BAD_PAGES];
+};
+#endif
+
 TEGRABL_PACKED(
 struct tboot_cpubl_params {
 
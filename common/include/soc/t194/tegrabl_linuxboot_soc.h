@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/**
+ * @file tegrabl_linuxboot_soc.h
+ *
+ * T194 specific placement of the OS images in OS carveout, in addition to
+ * the interfaces of tegrabl_linuxboot_helper.h
+ */
+
+#ifndef TEGRABL_LINUXBOOT_SOC_H
+#define TEGRABL_LINUXBOOT_SOC_H
+
+#include <stdint.h>
+#include <tegrabl_error.h>
+#include <tegrabl_partition_loader.h>
+
+struct tegrabl_linuxboot_memblock;
+
+/* Verifies a boot image (e.g. AVB) before anything in it gets used */
+typedef tegrabl_error_t (*tegrabl_bootimg_verify_fn_t)(const void *bootimg, uint64_t size, void *priv);
+
+/**
+ * @brief Size the placement of the kernel and ramdisk in OS carveout from the
+ * boot image they come from. Must be called with the verified boot image
+ * before the kernel and ramdisk load addresses are requested; without it, the
+ * worst case sizes are reserved.
+ *
+ * @param bootimg Pointer to the boot image
+ * @param size Size of the boot image buffer
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_INVALID if bootimg is not
+ *         a boot image (worst case sizes are reserved then)
+ */
+tegrabl_error_t tegrabl_set_boot_img_layout(const void *bootimg, uint64_t size);
+
+/**
+ * @brief Load the boot image of a partition with its kernel read straight to
+ * the kernel load address, and the ramdisk moved to the ramdisk load address.
+ * The image is authenticated (with CONFIG_ENABLE_SECURE_BOOT) and verified
+ * before anything in it is used. Must be called before any image is placed
+ * in OS carveout.
+ *
+ * @param partition_name Name of the partition holding the boot image
+ * @param bin_type Binary type of the boot image, for authentication
+ * @param verify Function verifying the boot image, with priv as argument
+ * @param priv Argument passed to verify
+ * @param kernel (output) Load address and size of the kernel
+ * @param ramdisk (output) Load address and size of the ramdisk
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_NOT_SUPPORTED if the
+ *         image cannot be loaded in place and tegrabl_get_boot_img_load_addr
+ *         has to be used, else appropriate error
+ */
+tegrabl_error_t tegrabl_load_bootimg_in_place(const char *partition_name, tegrabl_binary_type_t bin_type,
+											  tegrabl_bootimg_verify_fn_t verify, void *priv,
+											  struct tegrabl_linuxboot_memblock *kernel,
+											  struct tegrabl_linuxboot_memblock *ramdisk);
+
+#endif /* TEGRABL_LINUXBOOT_SOC_H */
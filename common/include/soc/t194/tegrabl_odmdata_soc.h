@@ -169,4 +169,18 @@ typedef uint32_t odmdata_prop_type_t;
 #define ENABLE_PCIE_C5_ENDPOINT 52
 #define ODMDATA_PROP_TYPE_MAX 53
 
+/* PCIe controller using the NVHS UPHY and the number of lanes it gets */
+#define PCIE_NVHS_CTRL_NUM				5U
+#define PCIE_NVHS_NUM_LANES				8U
+
+/**
+ * @brief Get the number of UPHY lanes assigned to a PCIe controller by the
+ * UPHY lane configuration (PCIE_XBAR and NVHS_UPHY fields) of ODMDATA
+ *
+ * @param ctrl_num PCIe controller number
+ *
+ * @return number of lanes, 0 if the controller owns no lane
+ */
+uint8_t tegrabl_odmdata_get_pcie_num_lanes(uint8_t ctrl_num);
+
 #endif /* TEGRABL_ODMDATA_SOC_H */
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+/**
+ * @file tegrabl_pcie_soc.h
+ *
+ * T194 specific PCIe controller interfaces, in addition to the ones of
+ * tegrabl_pcie.h
+ */
+
+#ifndef TEGRABL_PCIE_SOC_H
+#define TEGRABL_PCIE_SOC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <tegrabl_error.h>
+
+/**
+ * @brief Bring a set of controllers out of powergate and reset together,
+ * phase by phase, so that shared partitions and settle delays are handled
+ * once for all of them
+ *
+ * @param ctrl_nums controllers to be initialized
+ * @param num_ctrls number of entries in ctrl_nums
+ * @param results (output) per controller status
+ *
+ * @return TEGRABL_NO_ERROR if all the controllers succeeded, else the first error
+ */
+tegrabl_error_t tegrabl_pcie_soc_preinit_batch(const uint8_t *ctrl_nums, uint8_t num_ctrls,
+											   tegrabl_error_t *results);
+
+/**
+ * @brief Bring up the links of a set of PCIe controllers together, sharing a
+ * single PERST# window and link-up poll among them
+ *
+ * @param ctrl_nums controllers to be initialized
+ * @param num_ctrls number of entries in ctrl_nums
+ * @param link_speed target link speed
+ * @param results (output) per controller status, TEGRABL_NO_ERROR if the link
+ *        of ctrl_nums[i] is up
+ *
+ * @return TEGRABL_NO_ERROR if at least one link is up, TEGRABL_ERR_INIT_FAILED
+ *         if none is, TEGRABL_ERR_INVALID on invalid arguments
+ */
+tegrabl_error_t tegrabl_pcie_soc_init_links(const uint8_t *ctrl_nums, uint8_t num_ctrls, uint8_t link_speed,
+											tegrabl_error_t *results);
+
+/**
+ * @brief Set the time a controller may stay in Detect without detecting a
+ * receiver before its link training is abandoned
+ *
+ * @param timeout_us window in microseconds, 0 to always wait for the full
+ *        link-up timeout
+ */
+void tegrabl_pcie_soc_set_detect_timeout(uint32_t timeout_us);
+
+/**
+ * @brief Enable the regulators of a set of PCIe controllers together, paying
+ * a single ramp delay for all of them
+ *
+ * @param ctrl_nums controllers whose regulators are to be enabled
+ * @param num_ctrls number of entries in ctrl_nums
+ *
+ * @return TEGRABL_NO_ERROR if successful, appropriate error otherwise
+ */
+tegrabl_error_t tegrabl_pcie_enable_regulators_batch(const uint8_t *ctrl_nums, uint8_t num_ctrls);
+
+#if defined(CONFIG_ENABLE_PCIE_TELEMETRY)
+/**
+ * @brief Print the link training telemetry of a controller on the console
+ *
+ * @param ctrl_num controller number
+ */
+void tegrabl_pcie_soc_dump_telemetry(uint8_t ctrl_num);
+#endif
+
+#if defined(CONFIG_ENABLE_PCIE_LINK_HANDOFF) || defined(CONFIG_ENABLE_PCIE_TELEMETRY)
+/**
+ * @brief Publish the bootloader side state of a controller (kept link,
+ * link training telemetry) in its kernel DT node
+ *
+ * @param fdt kernel DT
+ * @param node_offset offset of a "nvidia,tegra194-pcie" node
+ *
+ * @return TEGRABL_NO_ERROR if successful, appropriate error otherwise
+ */
+tegrabl_error_t tegrabl_pcie_soc_update_kernel_dt(void *fdt, int32_t node_offset);
+#endif
+
+#if defined(CONFIG_ENABLE_PCIE_LINK_HANDOFF)
+/**
+ * @brief Leave the link of a controller powered and trained at handoff, and
+ * publish its state in the kernel DT
+ *
+ * @param ctrl_num controller number
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_INVALID if the link is not up
+ */
+tegrabl_error_t tegrabl_pcie_soc_keep_link(uint8_t ctrl_num);
+
+/**
+ * @brief Record a BAR assigned behind a kept link, to be published in the
+ * kernel DT along with the link state
+ *
+ * @param ctrl_num controller number, whose link is kept
+ * @param bdf bus/device/function of the owner of the BAR
+ * @param bar BAR index
+ * @param addr address assigned to the BAR
+ * @param size size of the BAR
+ *
+ * @return TEGRABL_NO_ERROR if successful, appropriate error otherwise
+ */
+tegrabl_error_t tegrabl_pcie_soc_record_bar(uint8_t ctrl_num, uint32_t bdf, uint32_t bar, uint64_t addr,
+											uint64_t size);
+#endif
+
+#if defined(CONFIG_ENABLE_NVME_BOOT)
+/* Checks the device behind a trained controller, e.g. with NVMe identify */
+typedef tegrabl_error_t (*tegrabl_pcie_probe_fn_t)(uint8_t ctrl_num, void *priv);
+
+/**
+ * @brief Bring up all the candidate NVMe controllers together and select the
+ * one to boot from, in order of their "nvidia,boot-priority"
+ *
+ * @param ctrl_nums candidate controllers, terminated with -1
+ * @param link_speed target link speed
+ * @param probe function checking the device behind a trained controller,
+ *        NULL to accept the first one
+ * @param priv argument passed to probe
+ *
+ * @return selected controller number, -1 if none
+ */
+int8_t tegrabl_pcie_soc_discover(const int8_t *ctrl_nums, uint8_t link_speed, tegrabl_pcie_probe_fn_t probe,
+								 void *priv);
+#endif
+
+#endif /* TEGRABL_PCIE_SOC_H */
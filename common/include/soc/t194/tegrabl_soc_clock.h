@@ -8,6 +8,9 @@
  * license agreement from NVIDIA Corporation is strictly prohibited.
  */
 
+#ifndef TEGRABL_SOC_CLOCK_H
+#define TEGRABL_SOC_CLOCK_H
+
 #define _MK_ENUM_CONST(_constant_) (_constant_ ## UL)
 
 #define PLLP_FIXED_FREQ_KHZ_13000            13000
@@ -276,3 +279,205 @@ void tegrabl_clk_uphy_lane_select_pll(uint32_t lane, uint32_t pll_sel);
  * @return TEGRABL_NO_ERROR if success, error-reason otherwise.
  */
 tegrabl_error_t tegrabl_usb_host_clock_init(void);
+
+/**
+ * @brief Handle of a BPMP request of the deferred batch
+ */
+typedef uint32_t tegrabl_bpmp_handle_t;
+
+/**
+ * @brief Handle of a request which did not need to be sent, waiting on it
+ * succeeds at once. Requests of the batch never get it as the bootloader does not
+ * issue 2^32 BPMP requests.
+ */
+#define TEGRABL_BPMP_HANDLE_NONE 0xFFFFFFFFU
+
+/**
+ * @brief Add a request to the deferred batch of BPMP requests. This is not
+ * an asynchronous interface: the transport is synchronous and the request is
+ * sent, and waited for, only when the caller waits on it, flushes the batch,
+ * or issues any synchronous clock/reset request, so requests of the batch
+ * reach BPMP in order.
+ *
+ * @param req request message, copied into the batch
+ * @param req_size size of the request
+ * @param resp_size size of the expected response, 0 if none
+ * @param mrq MRQ code of the request
+ * @param handle if not NULL, receives the handle to wait on
+ *
+ * @return TEGRABL_NO_ERROR if added, TEGRABL_ERR_INVALID if the message
+ * does not fit the batch
+ */
+tegrabl_error_t tegrabl_bpmp_batch_add(const void *req, uint32_t req_size, uint32_t resp_size,
+									   uint32_t mrq, tegrabl_bpmp_handle_t *handle);
+
+/**
+ * @brief Wait for a request of the batch, dispatching the ones added before it
+ *
+ * @param handle handle returned by tegrabl_bpmp_batch_add
+ * @param resp if not NULL, receives the response of the request
+ *
+ * @return status of the request, TEGRABL_ERR_NOT_FOUND if the handle is stale
+ */
+tegrabl_error_t tegrabl_bpmp_batch_wait(tegrabl_bpmp_handle_t handle, void *resp);
+
+/**
+ * @brief Dispatch all the requests of the batch
+ *
+ * @return first error hit by a request since the previous flush
+ */
+tegrabl_error_t tegrabl_bpmp_batch_flush(void);
+
+/**
+ * @brief Add a reset assert/deassert of a module to the batch, see
+ * tegrabl_bpmp_batch_add
+ *
+ * @param module module id
+ * @param instance module instance
+ * @param assert true to assert the reset, false to release it
+ * @param handle if not NULL, receives the handle to wait on for the status
+ *        of the reset, TEGRABL_BPMP_HANDLE_NONE if nothing was added
+ *
+ * @return TEGRABL_NO_ERROR if added, error-reason otherwise
+ */
+tegrabl_error_t tegrabl_car_rst_batch_add(tegrabl_module_t module, uint8_t instance, bool assert,
+										  tegrabl_bpmp_handle_t *handle);
+
+/**
+ * @brief Drop the shadow copy of the BPMP clock state, to be called when
+ * clocks were changed behind the clock driver
+ */
+void tegrabl_car_clk_cache_invalidate(void);
+
+/**
+ * @brief Get the number of clock state queries served from the shadow copy
+ * and from BPMP
+ *
+ * @param hits if not NULL, receives the queries served locally
+ * @param misses if not NULL, receives the queries sent to BPMP
+ */
+void tegrabl_car_clk_cache_stats(uint32_t *hits, uint32_t *misses);
+
+#define TEGRABL_PG_ID_NONE 0xFFFFFFFFU
+
+/**
+ * @brief Get the BPMP power partition of a module
+ *
+ * @param module module id
+ * @param instance module instance
+ *
+ * @return power partition id, TEGRABL_PG_ID_NONE if the module has none known
+ * to the clock driver
+ */
+uint32_t tegrabl_car_get_pg_id(tegrabl_module_t module, uint8_t instance);
+
+/**
+ * @brief Take a reference on a BPMP power partition. The partition, and the
+ * partitions it depends on, are powered on with the first reference.
+ *
+ * @param domain_id power partition id
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_INVALID if the partition
+ * is unknown, error from BPMP otherwise (the reference is not taken)
+ */
+tegrabl_error_t tegrabl_pg_get(uint32_t domain_id);
+
+/**
+ * @brief Drop a reference on a BPMP power partition. The partition is powered
+ * off when it loses its last reference. Dropping a reference which is not held
+ * forces the partition off if no one else holds it.
+ *
+ * @param domain_id power partition id
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_INVALID if the partition
+ * is unknown, error from BPMP otherwise
+ */
+tegrabl_error_t tegrabl_pg_put(uint32_t domain_id);
+
+/**
+ * @brief Defer the BPMP requests of tegrabl_pg_get/put till the matching
+ * tegrabl_pg_batch_commit. Batches may be nested.
+ */
+void tegrabl_pg_batch_begin(void);
+
+/**
+ * @brief Close a batch, the outermost one sends the BPMP requests needed for
+ * the references taken and dropped within, partitions being powered on
+ * before the ones depending on them and powered off after them.
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_INVALID if no batch is
+ * open, first error from BPMP otherwise
+ */
+tegrabl_error_t tegrabl_pg_batch_commit(void);
+
+/**
+ * @brief Get the number of references held on a BPMP power partition
+ *
+ * @param domain_id power partition id
+ *
+ * @return number of references, 0 if the partition is unknown
+ */
+uint32_t tegrabl_pg_refcount(uint32_t domain_id);
+
+#if defined(CONFIG_ENABLE_CLK_SNAPSHOT)
+#define TEGRABL_CLK_SNAPSHOT_MAX_ENTRIES 128U
+#define TEGRABL_CLK_SNAPSHOT_NO_PARENT 0xFFFFU
+#define TEGRABL_CLK_SNAPSHOT_STATE_UNKNOWN 0xFFU
+
+/**
+ * @brief State of a clock as reported by BPMP
+ *
+ * @param clk_id BPMP clock id
+ * @param parent_id BPMP clock id of the parent, TEGRABL_CLK_SNAPSHOT_NO_PARENT if unknown
+ * @param enabled 1 if the clock is enabled, 0 if disabled,
+ *        TEGRABL_CLK_SNAPSHOT_STATE_UNKNOWN if BPMP could not be queried
+ * @param rate_khz rate of the clock, 0 if unknown
+ */
+struct tegrabl_clk_snapshot_entry {
+	uint16_t clk_id;
+	uint16_t parent_id;
+	uint8_t enabled;
+	uint32_t rate_khz;
+};
+
+/**
+ * @brief Capture rate, parent and enable state of all the clocks the clock
+ * driver maps modules to, sorted by clock id. The state is read from BPMP,
+ * the shadow state of the clock driver is dropped first.
+ *
+ * @param entries table receiving the snapshot
+ * @param max_entries capacity of the table
+ * @param num_entries receives the number of valid entries
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_TOO_SMALL if the table
+ * can't hold all the clocks
+ */
+tegrabl_error_t tegrabl_clk_snapshot(struct tegrabl_clk_snapshot_entry *entries, uint32_t max_entries,
+									 uint32_t *num_entries);
+
+/**
+ * @brief Print a clock snapshot on the console
+ *
+ * @param entries snapshot taken by tegrabl_clk_snapshot
+ * @param num_entries number of entries in the snapshot
+ */
+void tegrabl_clk_snapshot_dump(const struct tegrabl_clk_snapshot_entry *entries, uint32_t num_entries);
+
+/**
+ * @brief Add a clock snapshot to a DT node as "nvidia,bl-clk-snapshot", with
+ * three cells <id | enabled << 31 | state unknown << 30, parent, rate in kHz>
+ * per clock
+ *
+ * @param fdt DT blob
+ * @param nodeoffset node receiving the property
+ * @param entries snapshot taken by tegrabl_clk_snapshot
+ * @param num_entries number of entries in the snapshot
+ *
+ * @return TEGRABL_NO_ERROR if successful, error-reason otherwise
+ */
+tegrabl_error_t tegrabl_clk_snapshot_add_to_dt(void *fdt, int32_t nodeoffset,
+											   const struct tegrabl_clk_snapshot_entry *entries,
+											   uint32_t num_entries);
+#endif /* CONFIG_ENABLE_CLK_SNAPSHOT */
+
+#endif /* TEGRABL_SOC_CLOCK_H */
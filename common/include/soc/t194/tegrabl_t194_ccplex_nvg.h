@@ -17,6 +17,25 @@
 
 #include <stdint.h>
 
+/* Maximum number of CCPLEX CPU cores and clusters on T194 */
+#define TEGRABL_CCPLEX_NVG_MAX_CORES		8U
+#define TEGRABL_CCPLEX_NVG_MAX_CLUSTERS		4U
+
+/**
+ * @brief CCPLEX CPU topology as reported by NVG
+ *
+ * @param num_cores Number of enabled cores as per floorsweeping configuration
+ * @param mpidr MPIDR of each logical core in the range [0,num_cores-1]
+ * @param cluster_mask Bit N is set if cluster N has at least one enabled core.
+ *        Each cluster has its own L2, so this is also the mask of the L2 caches
+ *        which are available.
+ */
+struct tegrabl_ccplex_nvg_topology {
+	uint32_t num_cores;
+	uint32_t mpidr[TEGRABL_CCPLEX_NVG_MAX_CORES];
+	uint32_t cluster_mask;
+};
+
 /**
  * @brief Probe the NVG interface version supported by the CCPLEX HW.
  *
@@ -42,4 +61,12 @@ uint32_t tegrabl_ccplex_nvg_num_cores(void);
  */
 uint32_t tegrabl_ccplex_nvg_logical_to_mpidr(uint32_t core);
 
+/**
+ * @brief Get the CCPLEX CPU topology. The NVG channels are queried only on the
+ * first call, subsequent calls return the cached snapshot.
+ *
+ * @return Pointer to the CPU topology snapshot
+ */
+const struct tegrabl_ccplex_nvg_topology *tegrabl_ccplex_nvg_get_topology(void);
+
 #endif /* INCLUED_TEGRABL_T194_CCPLEX_NVG_H */
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2021, NVIDIA Corporation. All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property and
+ * proprietary rights in and to this software and related documentation. Any
+ * use, reproduction, disclosure or distribution of this software and related
+ * documentation without an express license agreement from NVIDIA Corporation
+ * is strictly prohibited.
+ */
+
+#define MODULE TEGRABL_ERR_NO_MODULE
+
+#include "build_config.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <tegrabl_utils.h>
+#include <tegrabl_error.h>
+#include <tegrabl_debug.h>
+#include <tegrabl_interval_set.h>
+
+void tegrabl_interval_set_init(struct tegrabl_interval_set *set,
+							   struct tegrabl_interval *storage,
+							   uint32_t max_count)
+{
+	set->intervals = storage;
+	set->count = 0;
+	set->max_count = max_count;
+	set->is_normalized = true;
+}
+
+static tegrabl_error_t interval_set_append(struct tegrabl_interval_set *set,
+										   uint64_t start, uint64_t end)
+{
+	struct tegrabl_interval *last;
+
+	if (start >= end) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	if (set->count >= set->max_count) {
+		pr_error("interval set full (%u entries)\n", set->max_count);
+		return TEGRABL_ERROR(TEGRABL_ERR_TOO_SMALL, 0);
+	}
+
+	/* Appending beyond the last interval keeps the set normalized */
+	if (set->is_normalized && (set->count != 0U)) {
+		last = &set->intervals[set->count - 1U];
+		if (start <= last->end) {
+			set->is_normalized = false;
+		}
+	}
+
+	set->intervals[set->count].start = start;
+	set->intervals[set->count].end = end;
+	set->count++;
+
+	return TEGRABL_NO_ERROR;
+}
+
+tegrabl_error_t tegrabl_interval_set_add(struct tegrabl_interval_set *set,
+										 uint64_t base, uint64_t size)
+{
+	if ((base + size) < base) {
+		pr_error("region 0x%"PRIx64" + 0x%"PRIx64" wraps around\n", base, size);
+		return TEGRABL_ERROR(TEGRABL_ERR_INVALID, 0);
+	}
+
+	return interval_set_append(set, base, base + size);
+}
+
+static void interval_sift_down(struct tegrabl_interval *intervals,
+							   uint32_t root, uint32_t count)
+{
+	struct tegrabl_interval tmp;
+	uint32_t child;
+
+	while ((2U * root) + 1U < count) {
+		child = (2U * root) + 1U;
+		if (((child + 1U) < count) &&
+			(intervals[child].start < intervals[child + 1U].start)) {
+			child++;
+		}
+		if (intervals[root].start >= intervals[child].start) {
+			break;
+		}
+		tmp = intervals[root];
+		intervals[root] = intervals[child];
+		intervals[child] = tmp;
+		root = child;
+	}
+}
+
+/* In-place heap sort by start address, no additional storage required */
+static void interval_sort(struct tegrabl_interval *intervals, uint32_t count)
+{
+	struct tegrabl_interval tmp;
+	uint32_t i;
+
+	if (count < 2U) {
+		return;
+	}
+
+	for (i = count / 2U; i > 0U; i--) {
+		interval_sift_down(intervals, i - 1U, count);
+	}
+
+	for (i = count - 1U; i > 0U; i--) {
+		tmp = intervals[0];
+		intervals[0] = intervals[i];
+		intervals[i] = tmp;
+		interval_sift_down(intervals, 0, i);
+	}
+}
+
+void tegrabl_interval_set_normalize(struct tegrabl_interval_set *set)
+{
+	struct tegrabl_interval *intervals = set->intervals;
+	uint32_t i;
+	uint32_t rgn;
+
+	if (set->is_normalized) {
+		return;
+	}
+
+	interval_sort(intervals, set->count);
+
+	/* Merge the overlapping and adjacent intervals */
+	rgn = 0;
+	for (i = 1; i < set->count; i++) {
+		if (intervals[i].start <= intervals[rgn].end) {
+			if (intervals[i].end > intervals[rgn].end) {
+				intervals[rgn].end = intervals[i].end;
+			}
+		} else {
+			rgn++;
+			intervals[rgn] = intervals[i];
+		}
+	}
+
+	if (set->count != 0U) {
+		set->count = rgn + 1U;
+	}
+	set->is_normalized = true;
+}
+
+tegrabl_error_t tegrabl_interval_set_union(struct tegrabl_interval_set *out,
+										   struct tegrabl_interval_set *a,
+										   struct tegrabl_interval_set *b)
+{
+	tegrabl_error_t err = TEGRABL_NO_ERROR;
+	uint32_t i;
+
+	out->count = 0;
+	out->is_normalized = true;
+
+	for (i = 0; (i < a->count) && (err == TEGRABL_NO_ERROR); i++) {
+		err = interval_set_append(out, a->intervals[i].start, a->intervals[i].end);
+	}
+	for (i = 0; (i < b->count) && (err == TEGRABL_NO_ERROR); i++) {
+		err = interval_set_append(out, b->intervals[i].start, b->intervals[i].end);
+	}
+
+	tegrabl_interval_set_normalize(out);
+
+	return err;
+}
+
+tegrabl_error_t tegrabl_interval_set_subtract(struct tegrabl_interval_set *out,
+											  struct tegrabl_interval_set *a,
+											  struct tegrabl_interval_set *b)
+{
+	tegrabl_error_t err = TEGRABL_NO_ERROR;
+	uint64_t cur;
+	uint32_t i;
+	uint32_t j = 0;
+
+	tegrabl_interval_set_normalize(a);
+	tegrabl_interval_set_normalize(b);
+
+	out->count = 0;
+	out->is_normalized = true;
+
+	for (i = 0; (i < a->count) && (err == TEGRABL_NO_ERROR); i++) {
+		cur = a->intervals[i].start;
+
+		/* Skip the holes which end before this interval */
+		while ((j < b->count) && (b->intervals[j].end <= cur)) {
+			j++;
+		}
+
+		/* Punch out the holes overlapping this interval. A hole which extends
+		 * beyond this interval is kept for the next one. */
+		while ((j < b->count) && (b->intervals[j].start < a->intervals[i].end)) {
+			if (b->intervals[j].start > cur) {
+				err = interval_set_append(out, cur, b->intervals[j].start);
+				if (err != TEGRABL_NO_ERROR) {
+					break;
+				}
+			}
+			if (b->intervals[j].end > cur) {
+				cur = b->intervals[j].end;
+			}
+			if (b->intervals[j].end >= a->intervals[i].end) {
+				break;
+			}
+			j++;
+		}
+
+		if ((err == TEGRABL_NO_ERROR) && (cur < a->intervals[i].end)) {
+			err = interval_set_append(out, cur, a->intervals[i].end);
+		}
+	}
+
+	return err;
+}
+
+tegrabl_error_t tegrabl_interval_set_intersect(struct tegrabl_interval_set *out,
+											   struct tegrabl_interval_set *a,
+											   struct tegrabl_interval_set *b)
+{
+	tegrabl_error_t err = TEGRABL_NO_ERROR;
+	uint64_t start;
+	uint64_t end;
+	uint32_t i = 0;
+	uint32_t j = 0;
+
+	tegrabl_interval_set_normalize(a);
+	tegrabl_interval_set_normalize(b);
+
+	out->count = 0;
+	out->is_normalized = true;
+
+	while ((i < a->count) && (j < b->count) && (err == TEGRABL_NO_ERROR)) {
+		start = MAX(a->intervals[i].start, b->intervals[j].start);
+		end = MIN(a->intervals[i].end, b->intervals[j].end);
+
+		err = interval_set_append(out, start, end);
+
+		/* Advance whichever interval ends first */
+		if (a->intervals[i].end < b->intervals[j].end) {
+			i++;
+		} else {
+			j++;
+		}
+	}
+
+	return err;
+}
+
+void tegrabl_interval_set_align(struct tegrabl_interval_set *set,
+								uint64_t alignment, bool shrink)
+{
+	struct tegrabl_interval *intervals = set->intervals;
+	uint64_t mask = alignment - 1ULL;
+	uint64_t start;
+	uint64_t end;
+	uint32_t i;
+	uint32_t rgn = 0;
+
+	for (i = 0; i < set->count; i++) {
+		if (shrink) {
+			start = (intervals[i].start + mask) & ~mask;
+			end = intervals[i].end & ~mask;
+			/* Rounding up start may wrap around */
+			if (start < intervals[i].start) {
+				continue;
+			}
+		} else {
+			start = intervals[i].start & ~mask;
+			end = (intervals[i].end + mask) & ~mask;
+			/* Clamp at the top of the address space */
+			if (end < intervals[i].end) {
+				end = ~mask;
+			}
+		}
+
+		if (start < end) {
+			intervals[rgn].start = start;
+			intervals[rgn].end = end;
+			rgn++;
+		}
+	}
+	set->count = rgn;
+
+	/* Growing may make neighbouring intervals overlap */
+	if (!shrink) {
+		set->is_normalized = false;
+		tegrabl_interval_set_normalize(set);
+	}
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2021, NVIDIA Corporation.  All Rights Reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property and
+ * proprietary rights in and to this software and related documentation.  Any
+ * use, reproduction, disclosure or distribution of this software and related
+ * documentation without an express license agreement from NVIDIA Corporation
+ * is strictly prohibited.
+ */
+
+/* Host replacement of the tegrabl log macros, only errors are printed */
+
+#ifndef TEGRABL_DEBUG_H
+#define TEGRABL_DEBUG_H
+
+#include <stdio.h>
+
+static inline void host_log_discard(const char *fmt, ...)
+{
+	(void)fmt;
+}
+
+#define pr_error(...) fprintf(stderr, __VA_ARGS__)
+#define pr_warn(...) fprintf(stderr, __VA_ARGS__)
+#define pr_info(...) host_log_discard(__VA_ARGS__)
+#define pr_debug(...) host_log_discard(__VA_ARGS__)
+#define pr_trace(...) host_log_discard(__VA_ARGS__)
+
+#endif /* TEGRABL_DEBUG_H */
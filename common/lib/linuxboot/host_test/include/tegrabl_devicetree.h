@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2021, NVIDIA Corporation.  All Rights Reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property and
+ * proprietary rights in and to this software and related documentation.  Any
+ * use, reproduction, disclosure or distribution of this software and related
+ * documentation without an express license agreement from NVIDIA Corporation
+ * is strictly prohibited.
+ */
+
+/* Host replacement of the tegrabl DT helpers used by the code under test */
+
+#ifndef TEGRABL_DEVICETREE_H
+#define TEGRABL_DEVICETREE_H
+
+#include <libfdt.h>
+
+static inline int tegrabl_add_subnode_if_absent(void *fdt, int parentoffset, char *nodename)
+{
+	int node;
+
+	node = fdt_subnode_offset(fdt, parentoffset, nodename);
+	if (node == -FDT_ERR_NOTFOUND) {
+		node = fdt_add_subnode(fdt, parentoffset, nodename);
+	}
+
+	return node;
+}
+
+#endif /* TEGRABL_DEVICETREE_H */
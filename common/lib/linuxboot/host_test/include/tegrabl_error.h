@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2021, NVIDIA Corporation.  All Rights Reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property and
+ * proprietary rights in and to this software and related documentation.  Any
+ * use, reproduction, disclosure or distribution of this software and related
+ * documentation without an express license agreement from NVIDIA Corporation
+ * is strictly prohibited.
+ */
+
+/* Host replacement of the tegrabl error codes used by the code under test */
+
+#ifndef TEGRABL_ERROR_H
+#define TEGRABL_ERROR_H
+
+#include <stdint.h>
+
+typedef uint32_t tegrabl_error_t;
+
+#define TEGRABL_NO_ERROR 0U
+
+#define TEGRABL_ERR_NO_MODULE	0U
+#define TEGRABL_ERR_LINUXBOOT	1U
+
+#define TEGRABL_ERR_NOT_FOUND	1U
+#define TEGRABL_ERR_INVALID		2U
+#define TEGRABL_ERR_TOO_SMALL	3U
+#define TEGRABL_ERR_ADD_FAILED	4U
+#define TEGRABL_ERR_DEL_FAILED	5U
+#define TEGRABL_ERR_NO_MEMORY	6U
+
+#define TEGRABL_ERROR(reason, aux) \
+	((tegrabl_error_t)(((uint32_t)(MODULE) << 24) | ((uint32_t)(reason) << 8) | (uint32_t)(aux)))
+
+#define TEGRABL_SET_HIGHEST_MODULE(err) ((void)(err))
+
+#endif /* TEGRABL_ERROR_H */
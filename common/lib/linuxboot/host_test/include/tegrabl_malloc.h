@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2021, NVIDIA Corporation.  All Rights Reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property and
+ * proprietary rights in and to this software and related documentation.  Any
+ * use, reproduction, disclosure or distribution of this software and related
+ * documentation without an express license agreement from NVIDIA Corporation
+ * is strictly prohibited.
+ */
+
+/* Host replacement of the tegrabl heap */
+
+#ifndef TEGRABL_MALLOC_H
+#define TEGRABL_MALLOC_H
+
+#include <stdlib.h>
+
+#define tegrabl_malloc(size) malloc(size)
+#define tegrabl_free(ptr) free(ptr)
+
+#endif /* TEGRABL_MALLOC_H */
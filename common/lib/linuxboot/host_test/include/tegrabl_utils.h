@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2021, NVIDIA Corporation.  All Rights Reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property and
+ * proprietary rights in and to this software and related documentation.  Any
+ * use, reproduction, disclosure or distribution of this software and related
+ * documentation without an express license agreement from NVIDIA Corporation
+ * is strictly prohibited.
+ */
+
+/* Host replacement of the tegrabl helpers used by the code under test */
+
+#ifndef TEGRABL_UTILS_H
+#define TEGRABL_UTILS_H
+
+#include <stdio.h>
+
+#define U32(x) ((uint32_t)(x))
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define tegrabl_snprintf snprintf
+
+#endif /* TEGRABL_UTILS_H */
@@ -0,0 +1,663 @@
+/*
+ * Copyright (c) 2021, NVIDIA Corporation.  All Rights Reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property and
+ * proprietary rights in and to this software and related documentation.  Any
+ * use, reproduction, disclosure or distribution of this software and related
+ * documentation without an express license agreement from NVIDIA Corporation
+ * is strictly prohibited.
+ */
+
+/*
+ * Randomized host test of the libfdt-only linuxboot DT fixups and of the
+ * interval sets they publish:
+ *  - cpu floorsweeping, for random core masks, against a reference which
+ *    deletes the nodes one by one, for both the result and the time taken
+ *  - interval set operations, against a bitmap model
+ *  - DRAM bad page and unscrubbed DRAM publishing, read back from the blob
+ *
+ * Usage: linuxboot_dt_test [seed [iterations]]
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <libfdt.h>
+#include <tegrabl_error.h>
+#include <tegrabl_interval_set.h>
+#include "linuxboot_dt.h"
+
+#define FDT_SIZE			(512U * 1024U)
+/* Content after /cpus, so that each deletion there has something to move */
+#define FDT_TAIL_SIZE		(128U * 1024U)
+#define NUM_CPUS			8U
+#define NUM_CLUSTERS		4U
+
+#define NUM_UNITS			512U
+#define UNIT_SIZE			(64U * 1024U)
+#define UNIT_BASE			0x80000000ULL
+#define MAX_INTERVALS		NUM_UNITS
+
+static uint64_t rand_state;
+static uint32_t failures;
+
+#define CHECK(cond, ...) \
+	do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check '%s' failed: ", __func__, __LINE__, #cond); \
+			fprintf(stderr, __VA_ARGS__); \
+			fprintf(stderr, "\n"); \
+			failures++; \
+			return; \
+		} \
+	} while (0)
+
+#define FDT_CHECK(expr) \
+	do { \
+		int fdt_check_err = (expr); \
+		if (fdt_check_err < 0) { \
+			fprintf(stderr, "%s:%d: %s: %s\n", __func__, __LINE__, #expr, \
+					fdt_strerror(fdt_check_err)); \
+			exit(2); \
+		} \
+	} while (0)
+
+static uint32_t rand_u32(void)
+{
+	/* xorshift64* */
+	rand_state ^= rand_state >> 12;
+	rand_state ^= rand_state << 25;
+	rand_state ^= rand_state >> 27;
+
+	return (uint32_t)((rand_state * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+static uint32_t rand_below(uint32_t n)
+{
+	return rand_u32() % n;
+}
+
+/* Properties are only 4-byte aligned */
+static uint64_t prop_u64(const void *prop, uint32_t index)
+{
+	uint64_t value;
+
+	memcpy(&value, (const uint8_t *)prop + (index * sizeof(value)), sizeof(value));
+
+	return fdt64_to_cpu(value);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Floorsweeping
+ */
+
+static uint32_t dt_cpu_mpidr(uint32_t core)
+{
+	return ((core / 2U) << 8) | (core % 2U);
+}
+
+/* Build a blob with a t194 like /cpus, random non-cpu nodes in between */
+static void build_cpus_fdt(void *fdt, uint32_t addr_cells)
+{
+	uint32_t reg[2];
+	uint32_t core;
+	uint32_t cluster;
+	char name[32];
+	void *tail;
+
+	FDT_CHECK(fdt_create(fdt, FDT_SIZE));
+	FDT_CHECK(fdt_finish_reservemap(fdt));
+	FDT_CHECK(fdt_begin_node(fdt, ""));
+	FDT_CHECK(fdt_property_u32(fdt, "#address-cells", 2));
+	FDT_CHECK(fdt_property_u32(fdt, "#size-cells", 2));
+
+	FDT_CHECK(fdt_begin_node(fdt, "cpus"));
+	FDT_CHECK(fdt_property_u32(fdt, "#address-cells", addr_cells));
+	FDT_CHECK(fdt_property_u32(fdt, "#size-cells", 0));
+	for (core = 0; core < NUM_CPUS; core++) {
+		if (rand_below(4) == 0U) {
+			snprintf(name, sizeof(name), "l2-cache%u", core);
+			FDT_CHECK(fdt_begin_node(fdt, name));
+			FDT_CHECK(fdt_property_string(fdt, "compatible", "cache"));
+			FDT_CHECK(fdt_end_node(fdt));
+		}
+		snprintf(name, sizeof(name), "cpu@%x", dt_cpu_mpidr(core));
+		FDT_CHECK(fdt_begin_node(fdt, name));
+		FDT_CHECK(fdt_property_string(fdt, "compatible", "nvidia,tegra194-carmel"));
+		FDT_CHECK(fdt_property_string(fdt, "device_type", "cpu"));
+		reg[0] = 0;
+		reg[1] = cpu_to_fdt32(dt_cpu_mpidr(core));
+		FDT_CHECK(fdt_property(fdt, "reg", (addr_cells == 2U) ? reg : &reg[1],
+							   addr_cells * sizeof(uint32_t)));
+		FDT_CHECK(fdt_property_u32(fdt, "phandle", core + 1U));
+		FDT_CHECK(fdt_end_node(fdt));
+	}
+
+	FDT_CHECK(fdt_begin_node(fdt, "cpu-map"));
+	for (cluster = 0; cluster < NUM_CLUSTERS; cluster++) {
+		snprintf(name, sizeof(name), "cluster%u", cluster);
+		FDT_CHECK(fdt_begin_node(fdt, name));
+		for (core = 0; core < 2U; core++) {
+			snprintf(name, sizeof(name), "core%u", core);
+			FDT_CHECK(fdt_begin_node(fdt, name));
+			FDT_CHECK(fdt_property_u32(fdt, "cpu", (cluster * 2U) + core + 1U));
+			FDT_CHECK(fdt_end_node(fdt));
+		}
+		FDT_CHECK(fdt_end_node(fdt));
+	}
+	FDT_CHECK(fdt_end_node(fdt));
+	FDT_CHECK(fdt_end_node(fdt));
+
+	FDT_CHECK(fdt_begin_node(fdt, "tail"));
+	FDT_CHECK(fdt_property_placeholder(fdt, "data", FDT_TAIL_SIZE, &tail));
+	memset(tail, 0xa5, FDT_TAIL_SIZE);
+	FDT_CHECK(fdt_end_node(fdt));
+
+	FDT_CHECK(fdt_begin_node(fdt, "reserved-memory"));
+	FDT_CHECK(fdt_end_node(fdt));
+	FDT_CHECK(fdt_begin_node(fdt, "chosen"));
+	FDT_CHECK(fdt_end_node(fdt));
+
+	FDT_CHECK(fdt_end_node(fdt));
+	FDT_CHECK(fdt_finish(fdt));
+	FDT_CHECK(fdt_open_into(fdt, fdt, FDT_SIZE));
+}
+
+static int nth_cpu_node(void *fdt, int cpus, uint32_t n)
+{
+	const char *type;
+	int node;
+
+	fdt_for_each_subnode(node, fdt, cpus) {
+		type = fdt_getprop(fdt, node, "device_type", NULL);
+		if ((type != NULL) && (strcmp(type, "cpu") == 0)) {
+			if (n == 0U) {
+				return node;
+			}
+			n--;
+		}
+	}
+
+	return -FDT_ERR_NOTFOUND;
+}
+
+/* Reference floorsweeping: delete the nodes one by one, looking them up again each time */
+static void floorsweep_reference(void *fdt, const uint32_t *mpidr, uint32_t num_cores)
+{
+	uint32_t reg[2];
+	uint32_t addr_cells;
+	uint32_t cluster;
+	uint32_t i;
+	char name[32];
+	int cpus;
+	int node;
+
+	cpus = fdt_path_offset(fdt, "/cpus");
+	addr_cells = fdt32_to_cpu(*(const uint32_t *)fdt_getprop(fdt, cpus, "#address-cells", NULL));
+
+	for (i = 0; i < num_cores; i++) {
+		node = nth_cpu_node(fdt, cpus, i);
+		if (node < 0) {
+			break;
+		}
+		snprintf(name, sizeof(name), "cpu@%x", mpidr[i]);
+		FDT_CHECK(fdt_set_name(fdt, node, name));
+		reg[0] = 0;
+		reg[1] = cpu_to_fdt32(mpidr[i]);
+		FDT_CHECK(fdt_setprop_inplace(fdt, node, "reg", (addr_cells == 2U) ? reg : &reg[1],
+									  addr_cells * sizeof(uint32_t)));
+	}
+
+	for (;;) {
+		cpus = fdt_path_offset(fdt, "/cpus");
+		node = nth_cpu_node(fdt, cpus, num_cores);
+		if (node < 0) {
+			break;
+		}
+		FDT_CHECK(fdt_del_node(fdt, node));
+	}
+
+	for (cluster = 0; cluster < NUM_CLUSTERS; cluster++) {
+		if ((cluster * 2U) >= num_cores) {
+			snprintf(name, sizeof(name), "/cpus/cpu-map/cluster%u", cluster);
+			node = fdt_path_offset(fdt, name);
+			if (node >= 0) {
+				FDT_CHECK(fdt_del_node(fdt, node));
+			}
+		}
+	}
+}
+
+/* Compare two subtrees: names, properties and subnodes, in order */
+static bool fdt_subtree_equal(const void *a, int node_a, const void *b, int node_b)
+{
+	const void *val_a;
+	const void *val_b;
+	const char *name_a;
+	const char *name_b;
+	int len_a;
+	int len_b;
+	int prop_a;
+	int prop_b;
+	int sub_a;
+	int sub_b;
+
+	if (strcmp(fdt_get_name(a, node_a, NULL), fdt_get_name(b, node_b, NULL)) != 0) {
+		return false;
+	}
+
+	prop_a = fdt_first_property_offset(a, node_a);
+	prop_b = fdt_first_property_offset(b, node_b);
+	while ((prop_a >= 0) && (prop_b >= 0)) {
+		val_a = fdt_getprop_by_offset(a, prop_a, &name_a, &len_a);
+		val_b = fdt_getprop_by_offset(b, prop_b, &name_b, &len_b);
+		if ((strcmp(name_a, name_b) != 0) || (len_a != len_b) ||
+			(memcmp(val_a, val_b, (size_t)len_a) != 0)) {
+			return false;
+		}
+		prop_a = fdt_next_property_offset(a, prop_a);
+		prop_b = fdt_next_property_offset(b, prop_b);
+	}
+	if ((prop_a >= 0) || (prop_b >= 0)) {
+		return false;
+	}
+
+	sub_a = fdt_first_subnode(a, node_a);
+	sub_b = fdt_first_subnode(b, node_b);
+	while ((sub_a >= 0) && (sub_b >= 0)) {
+		if (!fdt_subtree_equal(a, sub_a, b, sub_b)) {
+			return false;
+		}
+		sub_a = fdt_next_subnode(a, sub_a);
+		sub_b = fdt_next_subnode(b, sub_b);
+	}
+
+	return (sub_a < 0) && (sub_b < 0);
+}
+
+/* Check the result directly, independently of the reference */
+static void check_floorswept(void *fdt, const uint32_t *mpidr, uint32_t num_cores, uint32_t addr_cells)
+{
+	const uint32_t *reg;
+	uint32_t cluster;
+	uint32_t count = 0;
+	char name[32];
+	int cpus;
+	int node;
+	int len;
+
+	cpus = fdt_path_offset(fdt, "/cpus");
+	CHECK(cpus >= 0, "no /cpus");
+
+	for (;;) {
+		node = nth_cpu_node(fdt, cpus, count);
+		if (node < 0) {
+			break;
+		}
+		CHECK(count < num_cores, "cpu node %u left for %u cores", count, num_cores);
+		snprintf(name, sizeof(name), "cpu@%x", mpidr[count]);
+		CHECK(strcmp(fdt_get_name(fdt, node, NULL), name) == 0, "cpu %u is %s, expected %s",
+			  count, fdt_get_name(fdt, node, NULL), name);
+		reg = fdt_getprop(fdt, node, "reg", &len);
+		CHECK((reg != NULL) && (len == (int)(addr_cells * sizeof(uint32_t))), "cpu %u reg size", count);
+		CHECK(fdt32_to_cpu(reg[addr_cells - 1U]) == mpidr[count], "cpu %u reg 0x%x, expected 0x%x",
+			  count, fdt32_to_cpu(reg[addr_cells - 1U]), mpidr[count]);
+		CHECK((addr_cells == 1U) || (reg[0] == 0U), "cpu %u reg high cell", count);
+		count++;
+	}
+	CHECK(count == num_cores, "%u cpu nodes for %u cores", count, num_cores);
+
+	for (cluster = 0; cluster < NUM_CLUSTERS; cluster++) {
+		snprintf(name, sizeof(name), "/cpus/cpu-map/cluster%u", cluster);
+		node = fdt_path_offset(fdt, name);
+		CHECK((node >= 0) == ((cluster * 2U) < num_cores), "cluster%u %s for %u cores", cluster,
+			  (node >= 0) ? "kept" : "removed", num_cores);
+	}
+
+	node = fdt_path_offset(fdt, "/tail");
+	CHECK(node >= 0, "/tail lost");
+}
+
+static void test_floorsweep(uint32_t iterations)
+{
+	static uint8_t base[FDT_SIZE];
+	static uint8_t fdt[FDT_SIZE];
+	static uint8_t ref[FDT_SIZE];
+	uint32_t mpidr[NUM_CPUS];
+	uint64_t time_batched = 0;
+	uint64_t time_reference = 0;
+	uint64_t start;
+	uint32_t addr_cells;
+	uint32_t num_cores;
+	uint32_t mask;
+	uint32_t core;
+	uint32_t iter;
+	uint32_t failures_before = failures;
+	tegrabl_error_t err;
+
+	for (iter = 0; iter < iterations; iter++) {
+		/* Every mask is covered at least once */
+		mask = (iter < 256U) ? iter : rand_below(256);
+		addr_cells = 1U + rand_below(2);
+		build_cpus_fdt(base, addr_cells);
+
+		num_cores = 0;
+		for (core = 0; core < NUM_CPUS; core++) {
+			if ((mask & (1U << core)) != 0U) {
+				mpidr[num_cores++] = dt_cpu_mpidr(core);
+			}
+		}
+
+		memcpy(fdt, base, FDT_SIZE);
+		memcpy(ref, base, FDT_SIZE);
+
+		start = now_ns();
+		err = tegrabl_linuxboot_dt_floorsweep_cpus(fdt, fdt_path_offset(fdt, "/cpus"), mpidr, num_cores);
+		time_batched += now_ns() - start;
+
+		start = now_ns();
+		floorsweep_reference(ref, mpidr, num_cores);
+		time_reference += now_ns() - start;
+
+		if (err != TEGRABL_NO_ERROR) {
+			fprintf(stderr, "floorsweep mask 0x%02x: error 0x%08x\n", mask, err);
+			failures++;
+			return;
+		}
+		check_floorswept(fdt, mpidr, num_cores, addr_cells);
+		if (!fdt_subtree_equal(fdt, 0, ref, 0)) {
+			fprintf(stderr, "floorsweep mask 0x%02x, #address-cells %u: differs from reference\n",
+					mask, addr_cells);
+			failures++;
+		}
+		if (failures != failures_before) {
+			return;
+		}
+	}
+
+	printf("floorsweep: %u masks, batched %" PRIu64 " us, per-node delete %" PRIu64 " us\n",
+		   iterations, time_batched / 1000U, time_reference / 1000U);
+	if (time_batched >= time_reference) {
+		fprintf(stderr, "floorsweep: batched removal is not faster than per-node deletion\n");
+		failures++;
+	}
+}
+
+/*
+ * Interval sets, modelled by a bitmap of NUM_UNITS units of UNIT_SIZE bytes
+ */
+
+struct model {
+	bool unit[NUM_UNITS];
+};
+
+static uint64_t unit_addr(uint32_t unit)
+{
+	return UNIT_BASE + ((uint64_t)unit * UNIT_SIZE);
+}
+
+static void random_set(struct tegrabl_interval_set *set, struct tegrabl_interval *storage,
+					   struct model *model, uint32_t max_len)
+{
+	uint32_t num = rand_below(MAX_INTERVALS / 8U);
+	uint32_t start;
+	uint32_t len;
+	uint32_t i;
+	uint32_t u;
+
+	tegrabl_interval_set_init(set, storage, MAX_INTERVALS);
+	memset(model, 0, sizeof(*model));
+
+	for (i = 0; i < num; i++) {
+		start = rand_below(NUM_UNITS);
+		len = rand_below(max_len + 1U);
+		if ((start + len) > NUM_UNITS) {
+			len = NUM_UNITS - start;
+		}
+		if (tegrabl_interval_set_add(set, unit_addr(start), (uint64_t)len * UNIT_SIZE) != TEGRABL_NO_ERROR) {
+			fprintf(stderr, "interval set add failed\n");
+			exit(2);
+		}
+		for (u = start; u < (start + len); u++) {
+			model->unit[u] = true;
+		}
+	}
+}
+
+/* Check that a normalized set covers exactly the units of the model */
+static void check_set(const char *what, const struct tegrabl_interval_set *set, const struct model *model)
+{
+	struct model covered;
+	uint64_t addr;
+	uint32_t i;
+	uint32_t u;
+
+	memset(&covered, 0, sizeof(covered));
+	CHECK(set->is_normalized, "%s: not normalized", what);
+
+	for (i = 0; i < set->count; i++) {
+		CHECK(set->intervals[i].start < set->intervals[i].end, "%s: empty interval %u", what, i);
+		CHECK((i == 0U) || (set->intervals[i - 1U].end < set->intervals[i].start),
+			  "%s: intervals %u and %u overlap or touch", what, i - 1U, i);
+		for (addr = set->intervals[i].start; addr < set->intervals[i].end; addr += UNIT_SIZE) {
+			CHECK((addr >= UNIT_BASE) && (((addr - UNIT_BASE) % UNIT_SIZE) == 0U),
+				  "%s: 0x%" PRIx64 " off the unit grid", what, addr);
+			u = (uint32_t)((addr - UNIT_BASE) / UNIT_SIZE);
+			CHECK(u < NUM_UNITS, "%s: 0x%" PRIx64 " out of range", what, addr);
+			covered.unit[u] = true;
+		}
+	}
+
+	for (u = 0; u < NUM_UNITS; u++) {
+		CHECK(covered.unit[u] == model->unit[u], "%s: unit %u is %s, expected %s", what, u,
+			  covered.unit[u] ? "set" : "clear", model->unit[u] ? "set" : "clear");
+	}
+}
+
+static void test_interval_set(uint32_t iterations)
+{
+	static struct tegrabl_interval storage_a[MAX_INTERVALS];
+	static struct tegrabl_interval storage_b[MAX_INTERVALS];
+	static struct tegrabl_interval storage_out[MAX_INTERVALS];
+	struct tegrabl_interval_set a;
+	struct tegrabl_interval_set b;
+	struct tegrabl_interval_set out;
+	struct model model_a;
+	struct model model_b;
+	struct model expected;
+	uint32_t alignment;
+	uint32_t iter;
+	uint32_t u;
+	uint32_t v;
+	uint32_t failures_before = failures;
+	bool shrink;
+	bool all;
+	bool any;
+
+	for (iter = 0; (iter < iterations) && (failures == failures_before); iter++) {
+		random_set(&a, storage_a, &model_a, 1U + rand_below(32));
+		random_set(&b, storage_b, &model_b, 1U + rand_below(32));
+		tegrabl_interval_set_init(&out, storage_out, MAX_INTERVALS);
+
+		tegrabl_interval_set_normalize(&a);
+		check_set("normalize", &a, &model_a);
+
+		if (tegrabl_interval_set_union(&out, &a, &b) != TEGRABL_NO_ERROR) {
+			failures++;
+			break;
+		}
+		for (u = 0; u < NUM_UNITS; u++) {
+			expected.unit[u] = model_a.unit[u] || model_b.unit[u];
+		}
+		check_set("union", &out, &expected);
+
+		if (tegrabl_interval_set_subtract(&out, &a, &b) != TEGRABL_NO_ERROR) {
+			failures++;
+			break;
+		}
+		for (u = 0; u < NUM_UNITS; u++) {
+			expected.unit[u] = model_a.unit[u] && !model_b.unit[u];
+		}
+		check_set("subtract", &out, &expected);
+
+		if (tegrabl_interval_set_intersect(&out, &a, &b) != TEGRABL_NO_ERROR) {
+			failures++;
+			break;
+		}
+		for (u = 0; u < NUM_UNITS; u++) {
+			expected.unit[u] = model_a.unit[u] && model_b.unit[u];
+		}
+		check_set("intersect", &out, &expected);
+
+		/* Blocks of the alignment are kept if fully covered when shrinking, if touched when growing */
+		alignment = 1U << rand_below(5);
+		shrink = (rand_below(2) == 0U);
+		tegrabl_interval_set_align(&a, (uint64_t)alignment * UNIT_SIZE, shrink);
+		for (u = 0; u < NUM_UNITS; u += alignment) {
+			all = true;
+			any = false;
+			for (v = u; v < (u + alignment); v++) {
+				all = all && model_a.unit[v];
+				any = any || model_a.unit[v];
+			}
+			for (v = u; v < (u + alignment); v++) {
+				expected.unit[v] = shrink ? all : any;
+			}
+		}
+		check_set(shrink ? "align shrink" : "align grow", &a, &expected);
+	}
+
+	printf("interval set: %u iterations\n", iter);
+}
+
+/*
+ * Publishing of the DRAM bad pages and of the unscrubbed DRAM
+ */
+
+/* Check the reg of a published node against the intervals of a set */
+static void check_published(void *fdt, const char *path, const struct tegrabl_interval_set *set,
+							const char *compatible, bool no_map)
+{
+	const void *reg;
+	const char *compat;
+	uint32_t i;
+	int node;
+	int len;
+
+	node = fdt_path_offset(fdt, path);
+	if (set->count == 0U) {
+		CHECK(node == -FDT_ERR_NOTFOUND, "%s: present for an empty set", path);
+		return;
+	}
+	CHECK(node >= 0, "%s: missing", path);
+
+	reg = fdt_getprop(fdt, node, "reg", &len);
+	CHECK((reg != NULL) && (len == (int)(set->count * 2U * sizeof(uint64_t))),
+		  "%s: reg of %d bytes for %u ranges", path, len, set->count);
+	for (i = 0; i < set->count; i++) {
+		CHECK(prop_u64(reg, 2U * i) == set->intervals[i].start, "%s: range %u base", path, i);
+		CHECK(prop_u64(reg, (2U * i) + 1U) == (set->intervals[i].end - set->intervals[i].start),
+			  "%s: range %u size", path, i);
+	}
+
+	compat = fdt_getprop(fdt, node, "compatible", NULL);
+	if (compatible == NULL) {
+		CHECK(compat == NULL, "%s: unexpected compatible", path);
+	} else {
+		CHECK((compat != NULL) && (strcmp(compat, compatible) == 0), "%s: compatible", path);
+	}
+	CHECK((fdt_getprop(fdt, node, "no-map", NULL) != NULL) == no_map, "%s: no-map", path);
+}
+
+static void test_publish(uint32_t iterations)
+{
+	static uint8_t fdt[FDT_SIZE];
+	static struct tegrabl_interval storage[MAX_INTERVALS];
+	struct tegrabl_interval_set set;
+	struct model model;
+	uint64_t page;
+	uint32_t num_pages;
+	uint32_t iter;
+	uint32_t i;
+	uint32_t failures_before = failures;
+	int parent;
+
+	for (iter = 0; (iter < iterations) && (failures == failures_before); iter++) {
+		build_cpus_fdt(fdt, 2);
+
+		/* Bad pages are reported at any address within the page, neighbours get merged */
+		tegrabl_interval_set_init(&set, storage, MAX_INTERVALS);
+		memset(&model, 0, sizeof(model));
+		num_pages = rand_below(64);
+		for (i = 0; i < num_pages; i++) {
+			page = unit_addr(rand_below(NUM_UNITS)) + rand_below(UNIT_SIZE);
+			page &= ~((uint64_t)UNIT_SIZE - 1ULL);
+			model.unit[(page - UNIT_BASE) / UNIT_SIZE] = true;
+			if (tegrabl_interval_set_add(&set, page, UNIT_SIZE) != TEGRABL_NO_ERROR) {
+				failures++;
+				return;
+			}
+		}
+		tegrabl_interval_set_normalize(&set);
+		check_set("bad pages", &set, &model);
+
+		/* Publishing twice must update the node in place */
+		for (i = 0; i < 2U; i++) {
+			parent = fdt_path_offset(fdt, "/reserved-memory");
+			if (tegrabl_linuxboot_dt_add_ranges(fdt, parent, "dram-bad-pages", NULL, &set, true) !=
+				TEGRABL_NO_ERROR) {
+				fprintf(stderr, "publishing %u bad page ranges failed\n", set.count);
+				failures++;
+				return;
+			}
+		}
+		check_published(fdt, "/reserved-memory/dram-bad-pages", &set, NULL, true);
+
+		random_set(&set, storage, &model, 1U + rand_below(64));
+		tegrabl_interval_set_normalize(&set);
+		parent = fdt_path_offset(fdt, "/chosen");
+		if (tegrabl_linuxboot_dt_add_ranges(fdt, parent, "unscrubbed-dram", "nvidia,tegra194-unscrubbed-dram",
+											&set, false) != TEGRABL_NO_ERROR) {
+			fprintf(stderr, "publishing %u unscrubbed ranges failed\n", set.count);
+			failures++;
+			return;
+		}
+		check_published(fdt, "/chosen/unscrubbed-dram", &set, "nvidia,tegra194-unscrubbed-dram", false);
+	}
+
+	printf("publish: %u iterations\n", iter);
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t seed = (argc > 1) ? strtoull(argv[1], NULL, 0) : (uint64_t)time(NULL);
+	uint32_t iterations = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1024U;
+
+	printf("seed %" PRIu64 "\n", seed);
+	rand_state = (seed != 0U) ? seed : 1U;
+
+	test_floorsweep(iterations);
+	test_interval_set(iterations);
+	test_publish(iterations);
+
+	if (failures != 0U) {
+		printf("FAILED (%u)\n", failures);
+		return 1;
+	}
+	printf("PASSED\n");
+
+	return 0;
+}
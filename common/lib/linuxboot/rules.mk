@@ -0,0 +1,31 @@
+#
+# Copyright (c) 2021, NVIDIA Corporation.  All Rights Reserved.
+#
+# NVIDIA Corporation and its licensors retain all intellectual property and
+# proprietary rights in and to this software and related documentation.  Any
+# use, reproduction, disclosure or distribution of this software and related
+# documentation without an express license agreement from NVIDIA Corporation
+# is strictly prohibited.
+#
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_DEPS += \
+	$(LOCAL_DIR)/../interval_set
+
+GLOBAL_INCLUDES += \
+	$(LOCAL_DIR) \
+	$(LOCAL_DIR)/../../include \
+	$(LOCAL_DIR)/../../include/lib \
+	$(LOCAL_DIR)/../../include/drivers \
+	$(LOCAL_DIR)/../../include/soc/$(TARGET)
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/$(TARGET)/linuxboot_helper.c \
+	$(LOCAL_DIR)/$(TARGET)/linuxboot_dt.c
+
+ALLMODULE_OBJS += $(LOCAL_DIR)/$(TARGET)/prebuilt/vpr.mod.o
+
+include make/module.mk
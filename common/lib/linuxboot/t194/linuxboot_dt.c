@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2015-2021, NVIDIA Corporation.  All Rights Reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property and
+ * proprietary rights in and to this software and related documentation.  Any
+ * use, reproduction, disclosure or distribution of this software and related
+ * documentation without an express license agreement from NVIDIA Corporation
+ * is strictly prohibited.
+ */
+
+#define MODULE	TEGRABL_ERR_LINUXBOOT
+
+#include "build_config.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <libfdt.h>
+#include <tegrabl_error.h>
+#include <tegrabl_debug.h>
+#include <tegrabl_malloc.h>
+#include <tegrabl_utils.h>
+#include <tegrabl_devicetree.h>
+#include <tegrabl_interval_set.h>
+#include "linuxboot_dt.h"
+
+#define MAX_T194_CLUSTERS	U32(4)
+/* Upper bound on the number of cpu nodes under /cpus which can be removed */
+#define MAX_DT_CPU_NODES	U32(16)
+
+static int get_addr_cells(void *fdt, int nodeoffset, uint32_t *cells)
+{
+	const uint32_t *prop;
+
+	prop = fdt_getprop(fdt, nodeoffset, "#address-cells", NULL);
+	if (prop != NULL) {
+		*cells = fdt32_to_cpu(*(uint32_t *)prop);
+		return 0;
+	}
+
+	return -FDT_ERR_NOTFOUND;
+}
+
+/**
+ * @brief Remove the given nodes from the DT.
+ *
+ * The nodes are overwritten with NOP tags instead of being deleted, so the
+ * size of the blob does not change and the offsets of all the nodes (including
+ * the ones still in the list) remain valid. This allows to collect all the
+ * offsets first and remove the nodes afterwards in one go, without having to
+ * rewind or re-resolve anything.
+ *
+ * @param fdt Pointer to the FDT blob
+ * @param offsets Offsets of the nodes to be removed
+ * @param count Number of nodes in the list
+ *
+ * @return TEGRABL_NO_ERROR if successful, else TEGRABL_ERR_DEL_FAILED
+ */
+static tegrabl_error_t remove_dt_nodes(void *fdt, const int *offsets, uint32_t count)
+{
+	tegrabl_error_t status = TEGRABL_NO_ERROR;
+	const char *name;
+	uint32_t i;
+	int err;
+
+	for (i = 0; i < count; i++) {
+		name = fdt_get_name(fdt, offsets[i], NULL);
+		if (name != NULL) {
+			pr_info("Deleted %s node in DT\n", name);
+		}
+
+		err = fdt_nop_node(fdt, offsets[i]);
+		if (err < 0) {
+			pr_error("failed to delete node at offset %d: %s\n",
+					 offsets[i], fdt_strerror(err));
+			status = TEGRABL_ERROR(TEGRABL_ERR_DEL_FAILED, 0);
+		}
+	}
+
+	return status;
+}
+
+tegrabl_error_t tegrabl_linuxboot_dt_floorsweep_cpus(void *fdt, int nodeoffset,
+													 const uint32_t *mpidr,
+													 uint32_t num_cores)
+{
+	uint32_t cpu = 0;
+	uint32_t cluster;
+	int offset;
+	int cpu_map_offset;
+	int del_offsets[MAX_DT_CPU_NODES + MAX_T194_CLUSTERS];
+	uint32_t del_count = 0;
+	char cluster_node_str[] = "cluster10";
+	uint32_t addr_cells;
+	tegrabl_error_t status;
+	int err;
+
+	err = get_addr_cells(fdt, nodeoffset, &addr_cells);
+	if (err < 0) {
+		pr_error("Couldn't find #address-cells for /cpus\n");
+		return TEGRABL_ERROR(TEGRABL_ERR_NOT_FOUND, 0);
+	}
+
+	if (addr_cells != 1 && addr_cells != 2) {
+		pr_error("Invalid value '%d' for /cpus #address-cells\n", addr_cells);
+		return TEGRABL_ERROR(TEGRABL_ERR_INVALID, 0);
+	}
+
+	/* Update the correct MPIDR and enable the DT nodes of each enabled CPU;
+	 * mark the DT nodes of the floorswept cores for removal. Renaming a node
+	 * only moves the content after it, so the offsets already marked stay
+	 * valid. */
+	for (offset = fdt_first_subnode(fdt, nodeoffset);
+	     offset > 0;
+	     offset = fdt_next_subnode(fdt, offset)) {
+		/* enough to accomodate "cpu@0000000000000000\0" */
+		char name[4 + 16 + 1];
+		const void *prop;
+		int len;
+
+		/* skip non-CPU nodes */
+		prop = fdt_getprop(fdt, offset, "device_type", &len);
+		if (!prop || strcmp(prop, "cpu") != 0)
+			continue;
+
+		if (cpu < num_cores) {
+			uint32_t value[2], *ptr = value, cpu_mpidr;
+
+			cpu_mpidr = mpidr[cpu] & 0x00ffffffUL;
+
+			tegrabl_snprintf(name, sizeof(name), "cpu@%x", cpu_mpidr);
+
+			err = fdt_set_name(fdt, offset, name);
+			if (err < 0) {
+				pr_error("failed to set name for /cpus/%s: %s\n",
+					 name, fdt_strerror(err));
+			}
+			/* As mpidr is currently a 32-bit value,
+			 * on a system with a "address-cells = 2" property,
+			 * i.e. a system with 64-bit reg property
+			 * the higher 32-bits of reg will always be zero.
+			 */
+			if (addr_cells > 1)
+				*ptr++ = 0;
+
+			*ptr++ = cpu_to_fdt32(cpu_mpidr);
+
+			len = (ptr - value) * sizeof(*ptr);
+
+			err = fdt_setprop_inplace(fdt, offset, "reg", value, len);
+			if (err < 0)
+				pr_error("failed to write MPIDR to /cpus/%s: %s\n",
+					 name, fdt_strerror(err));
+		} else if (del_count < MAX_DT_CPU_NODES) {
+			del_offsets[del_count++] = offset;
+		} else {
+			pr_error("Too many cpu nodes in /cpus, not deleting %s\n",
+					 fdt_get_name(fdt, offset, NULL));
+		}
+
+		cpu++;
+	}
+
+	cpu_map_offset = fdt_subnode_offset(fdt, nodeoffset, "cpu-map");
+	if (cpu_map_offset < 0) {
+		pr_error("/cpus/cpu-map does not exist\n");
+	} else {
+		for (cluster = 0; cluster < MAX_T194_CLUSTERS; cluster++) {
+			tegrabl_snprintf(cluster_node_str, 9, "cluster%u", cluster);
+			offset = fdt_subnode_offset(fdt, cpu_map_offset, cluster_node_str);
+
+			if ((offset >= 0) && (cluster * 2 >= num_cores)) {
+				del_offsets[del_count++] = offset;
+			}
+		}
+	}
+
+	/* Remove all the marked nodes at once */
+	status = remove_dt_nodes(fdt, del_offsets, del_count);
+	if (status != TEGRABL_NO_ERROR) {
+		TEGRABL_SET_HIGHEST_MODULE(status);
+		return status;
+	}
+
+	return TEGRABL_NO_ERROR;
+}
+
+tegrabl_error_t tegrabl_linuxboot_dt_add_ranges(void *fdt, int nodeoffset,
+												const char *name,
+												const char *compatible,
+												const struct tegrabl_interval_set *set,
+												bool no_map)
+{
+	uint64_t *buf;
+	size_t sz_buf;
+	uint32_t i;
+	int dterr, node;
+	tegrabl_error_t status = TEGRABL_NO_ERROR;
+
+	if (set->count == 0U) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	node = tegrabl_add_subnode_if_absent(fdt, nodeoffset, (char *)name);
+	if (node < 0) {
+		pr_error("failed to add %s node\n", name);
+		return TEGRABL_ERROR(TEGRABL_ERR_ADD_FAILED, 0);
+	}
+
+	if (compatible != NULL) {
+		dterr = fdt_setprop_string(fdt, node, "compatible", compatible);
+		if (dterr < 0) {
+			pr_error("failed to add %s/compatible property\n", name);
+			return TEGRABL_ERROR(TEGRABL_ERR_ADD_FAILED, 1);
+		}
+	}
+
+	sz_buf = sizeof(uint64_t) * 2U * set->count;
+	buf = tegrabl_malloc(sz_buf);
+	if (buf == NULL) {
+		pr_error("%d: Failed to allocate memory\n", __LINE__);
+		return TEGRABL_ERROR(TEGRABL_ERR_NO_MEMORY, 0);
+	}
+
+	for (i = 0; i < set->count; i++) {
+		buf[2U * i] = cpu_to_fdt64(set->intervals[i].start);
+		buf[(2U * i) + 1U] = cpu_to_fdt64(set->intervals[i].end - set->intervals[i].start);
+	}
+
+	dterr = fdt_setprop(fdt, node, "reg", buf, sz_buf);
+	if (dterr < 0) {
+		pr_error("failed to add %s/reg property\n", name);
+		status = TEGRABL_ERROR(TEGRABL_ERR_ADD_FAILED, 2);
+		goto out;
+	}
+
+	if (no_map) {
+		dterr = fdt_setprop(fdt, node, "no-map", NULL, 0);
+		if (dterr < 0) {
+			pr_error("failed to add %s/no-map property\n", name);
+			status = TEGRABL_ERROR(TEGRABL_ERR_ADD_FAILED, 3);
+			goto out;
+		}
+	}
+
+	pr_info("Added %u ranges to DT %s node\n", set->count, name);
+
+out:
+	tegrabl_free(buf);
+	return status;
+}
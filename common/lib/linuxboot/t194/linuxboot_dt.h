@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2021, NVIDIA Corporation.  All Rights Reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property and
+ * proprietary rights in and to this software and related documentation.  Any
+ * use, reproduction, disclosure or distribution of this software and related
+ * documentation without an express license agreement from NVIDIA Corporation
+ * is strictly prohibited.
+ */
+
+/**
+ * @file linuxboot_dt.h
+ *
+ * Kernel DT fixups which only depend on libfdt and on their arguments, kept
+ * apart from linuxboot_helper.c so that they can be built on the host too.
+ */
+
+#ifndef LINUXBOOT_DT_H
+#define LINUXBOOT_DT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <tegrabl_error.h>
+#include <tegrabl_interval_set.h>
+
+/**
+ * @brief Fix up /cpus for the enabled cores. The first num_cores cpu nodes
+ * get renamed to cpu@<mpidr> and their reg updated, the remaining cpu nodes
+ * and the cpu-map/clusterN nodes of the clusters without any enabled core are
+ * removed.
+ *
+ * @param fdt Pointer to the FDT blob
+ * @param nodeoffset Offset of the /cpus node
+ * @param mpidr MPIDR of each enabled core, in logical cpu order
+ * @param num_cores Number of enabled cores
+ *
+ * @return TEGRABL_NO_ERROR if successful, else appropriate error
+ */
+tegrabl_error_t tegrabl_linuxboot_dt_floorsweep_cpus(void *fdt, int nodeoffset,
+													 const uint32_t *mpidr,
+													 uint32_t num_cores);
+
+/**
+ * @brief Publish the intervals of a set as the reg property of a subnode,
+ * one <base size> pair of 64-bit values per interval. Nothing is added if
+ * the set is empty.
+ *
+ * @param fdt Pointer to the FDT blob
+ * @param nodeoffset Offset of the parent node
+ * @param name Name of the subnode, created if absent
+ * @param compatible Compatible string of the subnode, NULL for none
+ * @param set Normalized set of intervals
+ * @param no_map Add no-map property to the subnode
+ *
+ * @return TEGRABL_NO_ERROR if successful, else appropriate error
+ */
+tegrabl_error_t tegrabl_linuxboot_dt_add_ranges(void *fdt, int nodeoffset,
+												const char *name,
+												const char *compatible,
+												const struct tegrabl_interval_set *set,
+												bool no_map);
+
+#endif /* LINUXBOOT_DT_H */
@@ -21,11 +21,13 @@
 #include <tegrabl_error.h>
 #include <tegrabl_debug.h>
 #include <tegrabl_malloc.h>
+#include <tegrabl_utils.h>
 #include <tegrabl_compiler.h>
 #include <tegrabl_addressmap.h>
 #include <tegrabl_linuxboot.h>
 #include <tegrabl_linuxboot_helper.h>
 #include <tegrabl_sdram_usage.h>
+#include <tegrabl_linuxboot_soc.h>
 #include <tegrabl_cpubl_params.h>
 #include <linux_load.h>
 #include <tegrabl_ar_macro.h>
@@ -46,11 +48,25 @@
 #include <cboot_rollback_protection.h>
 #include <nvboot_boot_component.h>
 #include <tegrabl_partition_manager.h>
+#include <tegrabl_interval_set.h>
+#include "linuxboot_dt.h"
+#if defined(CONFIG_ENABLE_SECURE_BOOT)
+#include <tegrabl_auth.h>
+#endif
 
 #if defined(CONFIG_ENABLE_STAGED_SCRUBBING)
 #include <qual_engine.h>
 #endif
 
+#if defined(CONFIG_ENABLE_PCIE_LINK_HANDOFF) || defined(CONFIG_ENABLE_PCIE_TELEMETRY)
+#include <tegrabl_pcie_soc.h>
+#endif
+
+#if defined(CONFIG_ENABLE_CLK_SNAPSHOT)
+#include <tegrabl_clock.h>
+#include <tegrabl_soc_clock.h>
+#endif
+
 #if defined(CONFIG_ENABLE_A_B_SLOT)
 #include <tegrabl_a_b_boot_control.h>
 #endif
@@ -139,7 +155,7 @@ static int add_maxcpus(char *cmdline, int len, char *param, void *priv)
 	}
 
 #if defined(CONFIG_MULTICORE_SUPPORT)
-	num_cores = tegrabl_ccplex_nvg_num_cores();
+	num_cores = tegrabl_ccplex_nvg_get_topology()->num_cores;
 
 	return tegrabl_snprintf(cmdline, len, "%s=%u ", param, num_cores);
 #else
@@ -633,150 +649,13 @@ fail:
 	return status;
 }
 
-static int get_addr_cells(void *fdt, int nodeoffset, uint32_t *cells)
-{
-	const uint32_t *prop;
-
-	prop = fdt_getprop(fdt, nodeoffset, "#address-cells", NULL);
-	if (prop != NULL) {
-		*cells = fdt32_to_cpu(*(uint32_t *)prop);
-		return 0;
-	}
-
-	return -FDT_ERR_NOTFOUND;
-}
-
 #define MAX_T194_CPUS U32(8)
-#define MAX_T194_CLUSTERS	U32(4)
+
 static tegrabl_error_t update_cpu_floorsweeping_config(void *fdt, int nodeoffset)
 {
-	uint32_t cpu = 0;
-	uint32_t cluster;
-	int offset, prev = 0;
-	int cpu_map_offset;
-	char cluster_node_str[] = "cluster10";
-	uint32_t num_cores = tegrabl_ccplex_nvg_num_cores();
-	uint32_t addr_cells;
-	int err;
+	const struct tegrabl_ccplex_nvg_topology *topology = tegrabl_ccplex_nvg_get_topology();
 
-	err = get_addr_cells(fdt, nodeoffset, &addr_cells);
-	if (err < 0) {
-		pr_error("Couldn't find #address-cells for /cpus\n");
-		return TEGRABL_ERROR(TEGRABL_ERR_NOT_FOUND, 0);
-	}
-
-	if (addr_cells != 1 && addr_cells != 2) {
-		pr_error("Invalid value '%d' for /cpus #address-cells\n", addr_cells);
-		return TEGRABL_ERROR(TEGRABL_ERR_INVALID, 0);
-	}
-
-	/* Update the correct MPIDR and enable the DT nodes of each enabled CPU;
-	 * disable the DT nodes of the floorswept cores.*/
-	for (offset = fdt_first_subnode(fdt, nodeoffset);
-	     offset > 0;
-	     offset = fdt_next_subnode(fdt, offset)) {
-		/* enough to accomodate "cpu@0000000000000000\0" */
-		char name[4 + 16 + 1];
-		const void *prop;
-		int len;
-
-		/* skip non-CPU nodes */
-		prop = fdt_getprop(fdt, offset, "device_type", &len);
-		if (!prop || strcmp(prop, "cpu") != 0)
-			continue;
-
-		if (cpu < num_cores) {
-			uint32_t value[2], *ptr = value, mpidr;
-
-			mpidr = tegrabl_ccplex_nvg_logical_to_mpidr(cpu);
-			mpidr &= 0x00ffffffUL;
-
-			tegrabl_snprintf(name, sizeof(name), "cpu@%x", mpidr);
-
-			err = fdt_set_name(fdt, offset, name);
-			if (err < 0) {
-				pr_error("failed to set name for /cpus/%s: %s\n",
-					 name, fdt_strerror(err));
-			}
-			/* As mpidr is currently a 32-bit value,
-			 * on a system with a "address-cells = 2" property,
-			 * i.e. a system with 64-bit reg property
-			 * the higher 32-bits of reg will always be zero.
-			 */
-			if (addr_cells > 1)
-				*ptr++ = 0;
-
-			*ptr++ = cpu_to_fdt32(mpidr);
-
-			len = (ptr - value) * sizeof(*ptr);
-
-			err = fdt_setprop_inplace(fdt, offset, "reg", value, len);
-			if (err < 0)
-				pr_error("failed to write MPIDR to /cpus/%s: %s\n",
-					 name, fdt_strerror(err));
-		} else {
-			const char *node = fdt_get_name(fdt, offset, &len);
-
-			strncpy(name, node, sizeof(name));
-
-			err = fdt_del_node(fdt, offset);
-			if (err < 0)
-				pr_error("failed to delete /cpus/%s: %s\n",
-					 name, fdt_strerror(err));
-			else {
-				pr_info("Deleted %s node in DT\n", name);
-
-				/*
-				 * Deleting a node is a destructive operation,
-				 * which means that offsets will get messed up
-				 * and the iteration in the loop will fail.
-				 *
-				 * Correct for that by rewinding to the last
-				 * known subnode offset. Note that this won't
-				 * work if what we deleted was the first sub-
-				 * node. There's no good way to rewind in that
-				 * case because it would break the for-loop.
-				 *
-				 * However, we should never really get into
-				 * that situation because the last CPUs are
-				 * always the ones that get floorswept.
-				 */
-				if (prev > 0)
-					offset = prev;
-			}
-		}
-
-		/*
-		 * Keep a reference to the last subnode in case we need to
-		 * delete a node and rewind.
-		 */
-		prev = offset;
-		cpu++;
-	}
-
-	cpu_map_offset = fdt_subnode_offset(fdt, nodeoffset, "cpu-map");
-	if (cpu_map_offset < 0) {
-		pr_error("/cpus/cpu-map does not exist\n");
-		return TEGRABL_NO_ERROR;
-	}
-
-	for (cluster = 0; cluster < MAX_T194_CLUSTERS; cluster++) {
-		tegrabl_snprintf(cluster_node_str, 9, "cluster%u", cluster);
-		offset = fdt_subnode_offset(fdt, cpu_map_offset, cluster_node_str);
-
-		if ((offset >= 0) && (cluster * 2 >= num_cores)) {
-			err = fdt_del_node(fdt, offset);
-			if (err < 0) {
-				pr_error("Failed to delete /cpus/cpu-map/%s node: %s\n",
-					 cluster_node_str, fdt_strerror(err));
-				return TEGRABL_ERROR(TEGRABL_ERR_DEL_FAILED, 0);
-			}
-
-			pr_info("Deleted cluster%u node in FDT\n", cluster);
-		}
-	}
-
-	return TEGRABL_NO_ERROR;
+	return tegrabl_linuxboot_dt_floorsweep_cpus(fdt, nodeoffset, topology->mpidr, topology->num_cores);
 }
 
 static tegrabl_error_t update_armpmu_prop(void *fdt,
@@ -832,7 +711,7 @@ out:
 static tegrabl_error_t update_armpmu_floorsweeping_config(void *fdt, int nodeoffset)
 {
 	tegrabl_error_t err_code = TEGRABL_NO_ERROR;
-	uint32_t num_cores = tegrabl_ccplex_nvg_num_cores();
+	uint32_t num_cores = tegrabl_ccplex_nvg_get_topology()->num_cores;
 
 	/*
 	 * Modify arm-pmu DT node to ensure element count of properties:
@@ -888,9 +767,11 @@ static tegrabl_error_t update_vpr_info(void *fdt, int nodeoffset)
 		return TEGRABL_NO_ERROR; /* vpr DT node not present. we are good */
 	}
 
-	fdt_delprop(fdt, node, "compatible");
-	fdt_delprop(fdt, node, "reg");
-	fdt_delprop(fdt, node, "size");
+	/* NOP the properties in place instead of deleting them, so that the rest
+	 * of the blob does not get shifted for each of them */
+	fdt_nop_property(fdt, node, "compatible");
+	fdt_nop_property(fdt, node, "reg");
+	fdt_nop_property(fdt, node, "size");
 	return TEGRABL_NO_ERROR;
 }
 
@@ -936,6 +817,68 @@ static tegrabl_error_t update_cv_gos_info(void *fdt, int nodeoffset)
 	return TEGRABL_NO_ERROR;
 }
 
+#if defined(CONFIG_ENABLE_DRAM_BAD_PAGE_INFO)
+static struct tegrabl_interval dram_bad_page_storage[NUM_DRAM_BAD_PAGES];
+static struct tegrabl_interval_set dram_bad_pages;
+
+/**
+ * @brief Get the set of blacklisted DRAM pages. Neighbouring bad pages are
+ * merged into a single range. The set is built from the blacklisting info
+ * passed by MB2 on the first call.
+ *
+ * @return Pointer to the normalized set of bad page ranges
+ */
+static struct tegrabl_interval_set *get_dram_bad_pages(void)
+{
+	static bool is_initialized;
+	const struct tegrabl_dram_page_blacklist_info *blacklist_info;
+	uint64_t page_addr;
+	uint32_t i;
+
+	if (is_initialized) {
+		return &dram_bad_pages;
+	}
+	is_initialized = true;
+
+	tegrabl_interval_set_init(&dram_bad_pages, dram_bad_page_storage,
+							  ARRAY_SIZE(dram_bad_page_storage));
+
+	if ((boot_params->enable_dram_page_blacklisting == 0U) ||
+		(boot_params->dram_page_blacklist_info_address == 0ULL)) {
+		return &dram_bad_pages;
+	}
+
+	blacklist_info = (const struct tegrabl_dram_page_blacklist_info *)
+		(uintptr_t)boot_params->dram_page_blacklist_info_address;
+
+	for (i = 0; i < NUM_DRAM_BAD_PAGES; i++) {
+		page_addr = blacklist_info->page_addr[i];
+		if (page_addr == 0ULL) {
+			break;
+		}
+		page_addr &= ~((uint64_t)DRAM_BAD_PAGE_SIZE - 1ULL);
+		if (tegrabl_interval_set_add(&dram_bad_pages, page_addr, DRAM_BAD_PAGE_SIZE) !=
+			TEGRABL_NO_ERROR) {
+			pr_error("Invalid DRAM bad page 0x%"PRIx64"\n", page_addr);
+		}
+	}
+
+	/* Sort and merge all the bad pages in one pass */
+	tegrabl_interval_set_normalize(&dram_bad_pages);
+
+	pr_info("DRAM bad pages: %u, in %u ranges\n", i, dram_bad_pages.count);
+
+	return &dram_bad_pages;
+}
+
+/* Publish the blacklisted DRAM pages as a single reserved-memory node */
+static tegrabl_error_t add_dram_bad_pages_info(void *fdt, int nodeoffset)
+{
+	return tegrabl_linuxboot_dt_add_ranges(fdt, nodeoffset, "dram-bad-pages", NULL,
+										   get_dram_bad_pages(), true);
+}
+#endif /* CONFIG_ENABLE_DRAM_BAD_PAGE_INFO */
+
 static tegrabl_error_t add_device_info(void *fdt, int nodeoffset)
 {
 	tegrabl_error_t status = TEGRABL_NO_ERROR;
@@ -1054,68 +997,195 @@ fail:
 	return err;
 }
 
-static struct tegrabl_linuxboot_dtnode_info extra_nodes[] = {
-	{ "chosen", add_reset_info},
-	{ "chosen", add_ecid_info},
-	{ "cpus" , update_cpu_floorsweeping_config },
-	{ "arm-pmu", update_armpmu_floorsweeping_config },
-	{ "reserved-memory", update_vpr_info },
-	{ "reserved-memory", update_cv_gos_info },
-	{ "chosen", add_device_info },
-	{ NULL, NULL},
+#if defined(CONFIG_ENABLE_DEFERRED_SCRUBBING)
+/* Unscrubbed DRAM regions whose scrubbing is left to the OS */
+static struct tegrabl_interval deferred_scrub_storage[(2 * CARVEOUT_NUM) + 3];
+static struct tegrabl_interval_set deferred_scrub_regions = {
+	.intervals = deferred_scrub_storage,
+	.count = 0,
+	.max_count = ARRAY_SIZE(deferred_scrub_storage),
+	.is_normalized = true,
 };
 
-/**
- * @brief Compare BOM/base of two carveouts
+/*
+ * Publish the DRAM regions which are not scrubbed by the bootloader.
  *
- * @param a Index of the first carveout
- * @param b Index of the second carveout
+ * Binding:
+ *   /chosen/unscrubbed-dram
+ *     compatible = "nvidia,tegra194-unscrubbed-dram";
+ *     reg = <base-hi base-lo size-hi size-lo>, ...;
  *
- * @return -1: if BOM[a] < BOM [b],
- *          0: if BOM[a] == BOM[b], and
- *          1: if BOM[a] > BOM[b]
+ * Each reg entry is a range of DRAM which is part of the memory map (i.e. lies
+ * within the /memory regions, never within a carveout) but has never been
+ * written since power-on, so its ECC is not initialized. OS must
+ * write (scrub) a page of these ranges before handing it out. Ranges are
+ * sorted by base address, do not overlap and are aligned to 64 KB. Node is
+ * absent if all of DRAM has been scrubbed by the bootloader.
  */
-static int bom_compare(const uint32_t a, const uint32_t b)
+static tegrabl_error_t add_deferred_scrub_info(void *fdt, int nodeoffset)
 {
-	static struct tegrabl_carveout_info *p_carveout;
+	return tegrabl_linuxboot_dt_add_ranges(fdt, nodeoffset, "unscrubbed-dram",
+										   "nvidia,tegra194-unscrubbed-dram",
+										   &deferred_scrub_regions, false);
+}
+#endif
 
-	p_carveout = boot_params->carveout_info;
+#if defined(CONFIG_ENABLE_CLK_SNAPSHOT)
+/* Record the clock configuration handed over to the OS, on UART and in DT */
+static tegrabl_error_t add_clk_snapshot_info(void *fdt, int nodeoffset)
+{
+	struct tegrabl_clk_snapshot_entry *entries;
+	uint32_t num_entries = 0;
+	tegrabl_error_t err;
 
-	if (p_carveout[a].base < p_carveout[b].base)
-		return -1;
-	else if (p_carveout[a].base > p_carveout[b].base)
-		return 1;
-	else
-		return 0;
+	entries = tegrabl_malloc(TEGRABL_CLK_SNAPSHOT_MAX_ENTRIES * sizeof(*entries));
+	if (entries == NULL) {
+		pr_error("%d: Failed to allocate memory\n", __LINE__);
+		return TEGRABL_ERROR(TEGRABL_ERR_NO_MEMORY, 2);
+	}
+
+	err = tegrabl_clk_snapshot(entries, TEGRABL_CLK_SNAPSHOT_MAX_ENTRIES, &num_entries);
+	if (err != TEGRABL_NO_ERROR) {
+		pr_warn("Clock snapshot is incomplete (err = %x)\n", err);
+	}
+
+	if (num_entries != 0U) {
+		tegrabl_clk_snapshot_dump(entries, num_entries);
+		err = tegrabl_clk_snapshot_add_to_dt(fdt, nodeoffset, entries, num_entries);
+	}
+
+	tegrabl_free(entries);
+	return err;
 }
+#endif
+
+typedef tegrabl_error_t (*dt_fixup_fn_t)(void *fdt, int nodeoffset);
+
+/* Fixups applied on 'chosen' node, in order */
+static const dt_fixup_fn_t chosen_fixups[] = {
+	add_reset_info,
+	add_ecid_info,
+	add_device_info,
+#if defined(CONFIG_ENABLE_DEFERRED_SCRUBBING)
+	add_deferred_scrub_info,
+#endif
+#if defined(CONFIG_ENABLE_CLK_SNAPSHOT)
+	add_clk_snapshot_info,
+#endif
+	NULL,
+};
+
+/* Fixups applied on 'reserved-memory' node, in order */
+static const dt_fixup_fn_t reserved_memory_fixups[] = {
+	update_vpr_info,
+	update_cv_gos_info,
+#if defined(CONFIG_ENABLE_DRAM_BAD_PAGE_INFO)
+	add_dram_bad_pages_info,
+#endif
+	NULL,
+};
 
 /**
- * @brief Sorts the given array of carveout indexes in the increasing order of
- * their base address.
+ * @brief Run a list of fixups against a node whose offset has been looked up
+ * once.
+ *
+ * All the fixups only add/modify content inside the given node, which keeps
+ * the node offset valid across them, so the offset is reused instead of being
+ * looked up again for each fixup. The edits themselves are not batched: each
+ * fixup still goes through libfdt on its own. A failing fixup does not prevent
+ * the remaining ones from being applied.
  *
- * @param array[] Array of integers to be sorted
- * @param count Number of elements in the array
+ * @param fdt Pointer to the FDT blob
+ * @param nodeoffset Offset of the target node
+ * @param fixups NULL terminated list of fixups
+ *
+ * @return TEGRABL_NO_ERROR if all fixups succeeded, else error of the first
+ *         failing fixup
  */
-static void sort(uint32_t array[], int32_t count)
+static tegrabl_error_t apply_dt_fixups(void *fdt, int nodeoffset,
+									   const dt_fixup_fn_t *fixups)
 {
-	uint32_t val;
-	int32_t i;
-	int32_t j;
+	tegrabl_error_t status = TEGRABL_NO_ERROR;
+	tegrabl_error_t err;
+	uint32_t i;
 
-	if (count < 2)
-		return;
+	for (i = 0; fixups[i] != NULL; i++) {
+		err = fixups[i](fdt, nodeoffset);
+		if ((err != TEGRABL_NO_ERROR) && (status == TEGRABL_NO_ERROR)) {
+			status = err;
+		}
+	}
+
+	return status;
+}
 
-	for (i = 1; i < count; i++) {
-		val = array[i];
+#if defined(CONFIG_ENABLE_STAGED_SCRUBBING)
+static tegrabl_error_t dram_scrub_finish(void);
+static void dram_scrub_poll(void);
+#endif
 
-		for (j = (i - 1);
-			 (j >= 0) && (bom_compare(val, array[j]) < 0);
-			 j--) {
-			array[j + 1] = array[j];
-		}
+static tegrabl_error_t update_chosen_node(void *fdt, int nodeoffset)
+{
+#if defined(CONFIG_ENABLE_STAGED_SCRUBBING)
+	tegrabl_error_t err;
 
-		array[j + 1] = val;
+	/* Kernel DT gets fixed up on the way to the OS, DRAM must be scrubbed by then */
+	err = dram_scrub_finish();
+	if (err != TEGRABL_NO_ERROR) {
+		return err;
 	}
+#endif
+
+	return apply_dt_fixups(fdt, nodeoffset, chosen_fixups);
+}
+
+static tegrabl_error_t update_reserved_memory_node(void *fdt, int nodeoffset)
+{
+	return apply_dt_fixups(fdt, nodeoffset, reserved_memory_fixups);
+}
+
+/* Each node appears only once, so that its offset gets looked up only once */
+static struct tegrabl_linuxboot_dtnode_info extra_nodes[] = {
+	{ "chosen", update_chosen_node },
+	{ "cpus" , update_cpu_floorsweeping_config },
+	{ "arm-pmu", update_armpmu_floorsweeping_config },
+	{ "reserved-memory", update_reserved_memory_node },
+#if defined(CONFIG_ENABLE_PCIE_LINK_HANDOFF) || defined(CONFIG_ENABLE_PCIE_TELEMETRY)
+	/* PCIe controllers C0-C5, publish kept links and link training telemetry */
+	{ "pcie@14180000", tegrabl_pcie_soc_update_kernel_dt },
+	{ "pcie@14100000", tegrabl_pcie_soc_update_kernel_dt },
+	{ "pcie@14120000", tegrabl_pcie_soc_update_kernel_dt },
+	{ "pcie@14140000", tegrabl_pcie_soc_update_kernel_dt },
+	{ "pcie@14160000", tegrabl_pcie_soc_update_kernel_dt },
+	{ "pcie@141a0000", tegrabl_pcie_soc_update_kernel_dt },
+#endif
+	{ NULL, NULL},
+};
+
+/**
+ * @brief Determine the DRAM regions which are not covered by any of the given
+ * carveouts. The carveouts may be in any order and may overlap.
+ *
+ * @param carveouts Set of carveouts to be excluded
+ * @param regions Set which receives the remaining DRAM regions
+ *
+ * @return TEGRABL_NO_ERROR if successful, else appropriate error
+ */
+static tegrabl_error_t get_dram_regions_excluding(struct tegrabl_interval_set *carveouts,
+												  struct tegrabl_interval_set *regions)
+{
+	struct tegrabl_interval dram_storage[1];
+	struct tegrabl_interval_set dram;
+	tegrabl_error_t err;
+
+	tegrabl_interval_set_init(&dram, dram_storage, ARRAY_SIZE(dram_storage));
+
+	err = tegrabl_interval_set_add(&dram, SDRAM_START_ADDRESS, boot_params->sdram_size);
+	if (err != TEGRABL_NO_ERROR) {
+		return err;
+	}
+
+	return tegrabl_interval_set_subtract(regions, &dram, carveouts);
 }
 
 static struct tegrabl_linuxboot_memblock free_dram_block[CARVEOUT_NUM + 1];
@@ -1124,20 +1194,25 @@ static uint32_t free_dram_block_count;
 static void calculate_free_dram_regions(void)
 {
 	carve_out_type_t cotype;
-	int32_t i, rgn;
-	int32_t count;
-	uint64_t cur_start, cur_end;
-	uint32_t perm_carveouts[CARVEOUT_NUM];
-	static struct tegrabl_carveout_info *p_carveout;
+	uint32_t rgn;
+	struct tegrabl_carveout_info *p_carveout;
+	struct tegrabl_interval perm_storage[CARVEOUT_NUM];
+	struct tegrabl_interval free_storage[CARVEOUT_NUM + 1];
+	struct tegrabl_interval_set perm_carveouts;
+	struct tegrabl_interval_set free_regions;
+	static bool is_calculated;
+	tegrabl_error_t err;
 
-	if (p_carveout != NULL) {
+	if (is_calculated) {
 		/* We calculate all free DRAM regions at once,
 		 * If called again, just return*/
 		return;
 	}
+	is_calculated = true;
 
 	p_carveout = boot_params->carveout_info;
-	count = 0;
+	tegrabl_interval_set_init(&perm_carveouts, perm_storage, ARRAY_SIZE(perm_storage));
+	tegrabl_interval_set_init(&free_regions, free_storage, ARRAY_SIZE(free_storage));
 
 	/* Prepare a list of permanent DRAM carveouts */
 	for (cotype = CARVEOUT_NVDEC; cotype < CARVEOUT_NUM; cotype++) {
@@ -1154,44 +1229,30 @@ static void calculate_free_dram_regions(void)
 		case CARVEOUT_RCM_BLOB:
 			break;
 		default:
-			perm_carveouts[count] = (uint32_t)cotype;
-			count++;
+			err = tegrabl_interval_set_add(&perm_carveouts, p_carveout[cotype].base,
+										   p_carveout[cotype].size);
+			if (err != TEGRABL_NO_ERROR) {
+				pr_error("Invalid carveout %d\n", cotype);
+			}
 			break;
 		}
 	}
 
-	/* Sort the carveouts in increasing order of their base */
-	sort(perm_carveouts, count);
-
 	/* Determine the free regions */
-	cur_start = SDRAM_START_ADDRESS;
-	rgn = 0;
-
-	for (i = 0; i < count; i++) {
-		cur_end = p_carveout[perm_carveouts[i]].base;
-		if (cur_end > cur_start) {
-			pr_info("[%d] START: 0x%"PRIx64", END: 0x%"PRIx64"\n",
-					 rgn, cur_start, cur_end);
-			free_dram_block[rgn].base = cur_start;
-			free_dram_block[rgn].size = cur_end - cur_start;
-			rgn++;
-		}
-		cur_start = p_carveout[perm_carveouts[i]].base +
-			p_carveout[perm_carveouts[i]].size;
+	err = get_dram_regions_excluding(&perm_carveouts, &free_regions);
+	if (err != TEGRABL_NO_ERROR) {
+		pr_error("Failed to determine free DRAM regions\n");
 	}
 
-	pr_info("dram_block larger than %x\n", SDRAM_START_ADDRESS);
-
-	cur_end = SDRAM_START_ADDRESS +	boot_params->sdram_size;
-	if (cur_end > cur_start) {
-		pr_info("[%d] START: 0x%"PRIx64", END: 0x%"PRIx64"\n",
-				 rgn, cur_start, cur_end);
-		free_dram_block[rgn].base = cur_start;
-		free_dram_block[rgn].size = cur_end - cur_start;
-		rgn++;
+	for (rgn = 0; rgn < free_regions.count; rgn++) {
+		pr_info("[%u] START: 0x%"PRIx64", END: 0x%"PRIx64"\n", rgn,
+				free_regions.intervals[rgn].start, free_regions.intervals[rgn].end);
+		free_dram_block[rgn].base = free_regions.intervals[rgn].start;
+		free_dram_block[rgn].size = free_regions.intervals[rgn].end -
+			free_regions.intervals[rgn].start;
 	}
 
-	free_dram_block_count = rgn;
+	free_dram_block_count = free_regions.count;
 }
 
 static bool is_gsc_encryption_enabled(void)
@@ -1374,6 +1435,15 @@ tegrabl_error_t tegrabl_linuxboot_helper_get_info(tegrabl_linux_boot_info_t info
 		temp32 = *((uint32_t *)in_data);
 		memblock = (struct tegrabl_linuxboot_memblock *)out_data;
 
+#if defined(CONFIG_ENABLE_STAGED_SCRUBBING)
+		/* Free memory must not be handed over before it is scrubbed, in case
+		 * the memory map is requested ahead of dram_scrub_finish */
+		err = dram_scrub_finish();
+		if (err != TEGRABL_NO_ERROR) {
+			goto fail;
+		}
+#endif
+
 		calculate_free_dram_regions();
 
 		if (temp32 >= free_dram_block_count) {
@@ -1421,21 +1491,25 @@ static uint32_t unscrubbed_dram_block_count;
 static void calculate_unscrubbed_dram_regions(void)
 {
 	carve_out_type_t cotype;
-	int32_t i, rgn;
-	int32_t count;
-	uint32_t scrubbed_carveouts[CARVEOUT_NUM];
-	uint64_t cur_start, cur_end;
-
-	static struct tegrabl_carveout_info *p_carveout;
+	uint32_t rgn;
+	struct tegrabl_carveout_info *p_carveout;
+	struct tegrabl_interval scrubbed_storage[CARVEOUT_NUM];
+	struct tegrabl_interval unscrubbed_storage[CARVEOUT_NUM + 1];
+	struct tegrabl_interval_set scrubbed_carveouts;
+	struct tegrabl_interval_set unscrubbed_regions;
+	static bool is_calculated;
+	tegrabl_error_t err;
 
-	if (p_carveout != NULL) {
+	if (is_calculated) {
 		/* We calculate all unscrubbed DRAM regions at once,
 		 * If called again, just return*/
 		return;
 	}
+	is_calculated = true;
 
 	p_carveout = boot_params->carveout_info;
-	count = 0;
+	tegrabl_interval_set_init(&scrubbed_carveouts, scrubbed_storage, ARRAY_SIZE(scrubbed_storage));
+	tegrabl_interval_set_init(&unscrubbed_regions, unscrubbed_storage, ARRAY_SIZE(unscrubbed_storage));
 
 	/* Prepare a list of permanent DRAM carveouts */
 	for (cotype = CARVEOUT_NVDEC; cotype < CARVEOUT_NUM; cotype++) {
@@ -1477,72 +1551,211 @@ static void calculate_unscrubbed_dram_regions(void)
 #endif
 			pr_debug("PRE scrubbed \t co: [%d] START: 0x%"PRIx64", END: 0x%"PRIx64"\n",
 					cotype, p_carveout[cotype].base, p_carveout[cotype].base + p_carveout[cotype].size);
-			scrubbed_carveouts[count] = (uint32_t)cotype;
-			count++;
+			err = tegrabl_interval_set_add(&scrubbed_carveouts, p_carveout[cotype].base,
+										   p_carveout[cotype].size);
+			if (err != TEGRABL_NO_ERROR) {
+				pr_error("Invalid carveout %d\n", cotype);
+			}
 			break;
 		default:
 			break;
 		}
 	}
 
-	/* Sort the scrubbed carveouts in increasing order of their base */
-	sort(scrubbed_carveouts, count);
-
 	/* Determine the unscrubbed DRAM regions */
-	cur_start = SDRAM_START_ADDRESS;
-	rgn = 0;
-
-	for (i = 0; i < count; i++) {
-		cur_end = p_carveout[scrubbed_carveouts[i]].base;
-		if (cur_end > cur_start) {
-			pr_debug("[%d] unscrubbed region START: 0x%"PRIx64", END: 0x%"PRIx64"\n",
-					 rgn, cur_start, cur_end);
-			unscrubbed_dram_block[rgn].base = cur_start;
-			unscrubbed_dram_block[rgn].size = cur_end - cur_start;
-			rgn++;
-		}
-		cur_start = p_carveout[scrubbed_carveouts[i]].base +
-			p_carveout[scrubbed_carveouts[i]].size;
+	err = get_dram_regions_excluding(&scrubbed_carveouts, &unscrubbed_regions);
+	if (err != TEGRABL_NO_ERROR) {
+		pr_error("Failed to determine unscrubbed DRAM regions\n");
+	}
+
+	for (rgn = 0; rgn < unscrubbed_regions.count; rgn++) {
+		pr_debug("[%u] unscrubbed region START: 0x%"PRIx64", END: 0x%"PRIx64"\n", rgn,
+				 unscrubbed_regions.intervals[rgn].start, unscrubbed_regions.intervals[rgn].end);
+		unscrubbed_dram_block[rgn].base = unscrubbed_regions.intervals[rgn].start;
+		unscrubbed_dram_block[rgn].size = unscrubbed_regions.intervals[rgn].end -
+			unscrubbed_regions.intervals[rgn].start;
 	}
+	unscrubbed_dram_block_count = unscrubbed_regions.count;
+}
+
+/* Set once the regions to be scrubbed have been queued */
+static bool dram_scrub_started;
 
-	cur_end = SDRAM_START_ADDRESS + boot_params->sdram_size;
-	if (cur_end > cur_start) {
-		pr_debug("[%d] unscrubbed region START: 0x%"PRIx64", END: 0x%"PRIx64"\n",
-				 rgn, cur_start, cur_end);
-		unscrubbed_dram_block[rgn].base = cur_start;
-		unscrubbed_dram_block[rgn].size = cur_end - cur_start;
-		rgn++;
+static tegrabl_error_t queue_scrub_regions(struct tegrabl_interval_set *regions)
+{
+	tegrabl_error_t err = TEGRABL_NO_ERROR;
+	uint32_t i;
+
+	for (i = 0; i < regions->count; i++) {
+		err = tegrabl_sdram_qual_engine_queue_scrub(regions->intervals[i].start,
+				regions->intervals[i].end - regions->intervals[i].start);
+		if (err != TEGRABL_NO_ERROR) {
+			pr_debug("failed to queue region: %u\n", i);
+			break;
+		}
 	}
-	unscrubbed_dram_block_count = rgn;
+
+	return err;
 }
 
+/**
+ * @brief Queue the unscrubbed DRAM regions to the qual engine and return
+ * without waiting for the scrub to complete.
+ *
+ * The parts overlapping the OS carveout are queued first, as kernel/DTB/ramdisk
+ * get loaded there; the loaders wait only for those parts (see
+ * tegrabl_get_kernel_load_addr) while the rest of DRAM keeps getting scrubbed
+ * in background, one region after the other as dram_scrub_poll gets called.
+ * DRAM is scrubbed only once dram_scrub_finish has returned, which has to be
+ * called before handing over to the OS.
+ *
+ * With CONFIG_ENABLE_DEFERRED_SCRUBBING, only the OS carveout is scrubbed and
+ * the rest is published in DT for the OS to scrub (see add_deferred_scrub_info).
+ *
+ * @return TEGRABL_NO_ERROR if all the regions got queued, else appropriate error
+ */
 tegrabl_error_t dram_staged_scrub(void)
 {
 	tegrabl_error_t err = TEGRABL_NO_ERROR;
-	uint32_t i = 0;
+	struct tegrabl_interval unscrubbed_storage[CARVEOUT_NUM + 1];
+	struct tegrabl_interval os_storage[1];
+	struct tegrabl_interval os_part_storage[CARVEOUT_NUM + 1];
+	struct tegrabl_interval_set unscrubbed;
+	struct tegrabl_interval_set os_carveout;
+	struct tegrabl_interval_set os_part;
+	struct tegrabl_interval rest_storage[CARVEOUT_NUM + 2];
+	struct tegrabl_interval_set rest;
+#if defined(CONFIG_ENABLE_DEFERRED_SCRUBBING)
+	struct tegrabl_interval free_storage[CARVEOUT_NUM + 1];
+	struct tegrabl_interval carveout_part_storage[(2 * CARVEOUT_NUM) + 3];
+	struct tegrabl_interval_set free_regions;
+	struct tegrabl_interval_set carveout_part;
+#endif
+	uint32_t i;
 
 	calculate_unscrubbed_dram_regions();
 
-	for (i = 0; (i < unscrubbed_dram_block_count); i++) {
-		/* Scrub region */
-		err = tegrabl_sdram_qual_engine_init(unscrubbed_dram_block[i].base, unscrubbed_dram_block[i].size);
+	tegrabl_interval_set_init(&unscrubbed, unscrubbed_storage, ARRAY_SIZE(unscrubbed_storage));
+	tegrabl_interval_set_init(&os_carveout, os_storage, ARRAY_SIZE(os_storage));
+	tegrabl_interval_set_init(&os_part, os_part_storage, ARRAY_SIZE(os_part_storage));
+
+	for (i = 0; i < unscrubbed_dram_block_count; i++) {
+		err = tegrabl_interval_set_add(&unscrubbed, unscrubbed_dram_block[i].base,
+									   unscrubbed_dram_block[i].size);
 		if (err != TEGRABL_NO_ERROR) {
-			break;
+			goto fail;
 		}
-		err = tegrabl_sdram_qual_engine_wait_for_idle();
+	}
+
+	err = tegrabl_interval_set_add(&os_carveout, boot_params->carveout_info[CARVEOUT_OS].base,
+								   boot_params->carveout_info[CARVEOUT_OS].size);
+	if (err != TEGRABL_NO_ERROR) {
+		goto fail;
+	}
+
+	/* Queue the parts inside OS carveout */
+	err = tegrabl_interval_set_intersect(&os_part, &unscrubbed, &os_carveout);
+	if (err != TEGRABL_NO_ERROR) {
+		goto fail;
+	}
+	err = queue_scrub_regions(&os_part);
+	if (err != TEGRABL_NO_ERROR) {
+		goto fail;
+	}
+
+	/* Queue (or defer to OS) the parts below and above OS carveout */
+	tegrabl_interval_set_init(&rest, rest_storage, ARRAY_SIZE(rest_storage));
+	err = tegrabl_interval_set_subtract(&rest, &unscrubbed, &os_carveout);
+	if (err != TEGRABL_NO_ERROR) {
+		goto fail;
+	}
+
+#if defined(CONFIG_ENABLE_DEFERRED_SCRUBBING)
+	/* Only the free DRAM is handed over to the OS; the carveouts left
+	 * unscrubbed by MB2 (VPR, GSC, ...) may not even be writable by the OS,
+	 * so they are still scrubbed here */
+	calculate_free_dram_regions();
+	tegrabl_interval_set_init(&free_regions, free_storage, ARRAY_SIZE(free_storage));
+	for (i = 0; i < free_dram_block_count; i++) {
+		err = tegrabl_interval_set_add(&free_regions, free_dram_block[i].base, free_dram_block[i].size);
 		if (err != TEGRABL_NO_ERROR) {
-			break;
+			goto fail;
 		}
 	}
 
+	err = tegrabl_interval_set_intersect(&deferred_scrub_regions, &rest, &free_regions);
+	if (err != TEGRABL_NO_ERROR) {
+		goto fail;
+	}
+
+	tegrabl_interval_set_init(&carveout_part, carveout_part_storage, ARRAY_SIZE(carveout_part_storage));
+	err = tegrabl_interval_set_subtract(&carveout_part, &rest, &free_regions);
+	if (err != TEGRABL_NO_ERROR) {
+		goto fail;
+	}
+	err = queue_scrub_regions(&carveout_part);
+	if (err != TEGRABL_NO_ERROR) {
+		goto fail;
+	}
+	pr_info("dram scrub: %u regions deferred to OS\n", deferred_scrub_regions.count);
+#else
+	err = queue_scrub_regions(&rest);
+	if (err != TEGRABL_NO_ERROR) {
+		goto fail;
+	}
+#endif
+
+	dram_scrub_started = true;
+	pr_info("dram scrub started\n");
+
+fail:
 	if (err != TEGRABL_NO_ERROR) {
 		pr_error("dram scrub failed\n");
-		pr_debug("last iteration: %d\n", i);
-	} else {
-		pr_info("dram scrub successful\n");
 	}
 	return err;
+}
+
+/**
+ * @brief Advance the staged DRAM scrub without waiting: start the next queued
+ * region if the engine is done with the previous one. Called from the image
+ * load paths of this file, errors are reported by dram_scrub_finish.
+ */
+static void dram_scrub_poll(void)
+{
+	if (dram_scrub_started) {
+		(void)tegrabl_sdram_qual_engine_poll();
+	}
+}
+
+/**
+ * @brief Barrier for the staged DRAM scrub; waits until all the queued
+ * regions are scrubbed. Must be called on the handoff path before jumping to
+ * the OS, it returns right away once DRAM is scrubbed.
+ *
+ * @return TEGRABL_NO_ERROR if DRAM is scrubbed, else appropriate error
+ */
+static tegrabl_error_t dram_scrub_finish(void)
+{
+	static bool is_done;
+	struct tegrabl_qual_engine_scrub_stats stats;
+	tegrabl_error_t err;
+
+	if (is_done) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	err = tegrabl_sdram_qual_engine_wait_for_queue();
+	if (err != TEGRABL_NO_ERROR) {
+		pr_error("dram scrub failed\n");
+		return err;
+	}
+
+	tegrabl_sdram_qual_engine_get_stats(&stats);
+	pr_info("dram scrub successful: %u regions, 0x%"PRIx64" bytes in %"PRIu64" us\n",
+			stats.num_regions, stats.total_bytes, stats.total_time_us);
+	is_done = true;
 
+	return TEGRABL_NO_ERROR;
 }
 #endif /* CONFIG_ENABLE_STAGED_SCRUBBING */
 
@@ -1564,13 +1777,18 @@ tegrabl_error_t tegrabl_get_nct_load_addr(void **load_addr)
 	}
 	pr_trace("%s(): %u, NCT load addr: %p\n", __func__, __LINE__, *load_addr);
 
+#if defined(CONFIG_ENABLE_STAGED_SCRUBBING)
+	dram_scrub_poll();
+#endif
+
 fail:
 	return err;
 }
 
+static void *boot_img_load_addr;
+
 tegrabl_error_t tegrabl_get_boot_img_load_addr(void **load_addr)
 {
-	static void *boot_img_load_addr;
 	tegrabl_error_t err = TEGRABL_NO_ERROR;
 
 	if (boot_img_load_addr == NULL) {
@@ -1587,23 +1805,247 @@ tegrabl_error_t tegrabl_get_boot_img_load_addr(void **load_addr)
 	}
 	pr_trace("%s(): %u, boot image load addr: %p\n", __func__, __LINE__, *load_addr);
 
+#if defined(CONFIG_ENABLE_STAGED_SCRUBBING)
+	/* Keep the scrub going in between the images being loaded */
+	dram_scrub_poll();
+#endif
+
 fail:
 	return err;
 }
 
+#define ANDROID_BOOT_MAGIC			"ANDROID!"
+#define ANDROID_BOOT_MAGIC_SIZE		8U
+#define ANDROID_BOOT_V3_PAGE_SIZE	4096U
+
+/* Android boot image header, versions 0 to 2 (fields used here) */
+struct bootimg_hdr_v0 {
+	uint8_t magic[ANDROID_BOOT_MAGIC_SIZE];
+	uint32_t kernel_size;
+	uint32_t kernel_addr;
+	uint32_t ramdisk_size;
+	uint32_t ramdisk_addr;
+	uint32_t second_size;
+	uint32_t second_addr;
+	uint32_t tags_addr;
+	uint32_t page_size;
+	uint32_t header_version;
+};
+
+/* Android boot image header, versions 3 and above (fields used here) */
+struct bootimg_hdr_v3 {
+	uint8_t magic[ANDROID_BOOT_MAGIC_SIZE];
+	uint32_t kernel_size;
+	uint32_t ramdisk_size;
+	uint32_t os_version;
+	uint32_t header_size;
+	uint32_t reserved[4];
+	uint32_t header_version;
+};
+
+/**
+ * @brief Location of the sections inside a boot image
+ */
+struct bootimg_layout {
+	uint64_t kernel_offset;
+	uint64_t kernel_size;
+	uint64_t ramdisk_offset;
+	uint64_t ramdisk_size;
+};
+
+/**
+ * @brief Parse the header of an Android boot image
+ *
+ * @param hdr Pointer to the boot image header
+ * @param layout (output) Location of the kernel and ramdisk in the boot image
+ *
+ * @return true if header is valid, false otherwise
+ */
+static bool parse_bootimg_hdr(const void *hdr, struct bootimg_layout *layout)
+{
+	const struct bootimg_hdr_v0 *hdr_v0 = hdr;
+	const struct bootimg_hdr_v3 *hdr_v3 = hdr;
+	uint64_t page_size;
+
+	if (memcmp(hdr_v0->magic, ANDROID_BOOT_MAGIC, ANDROID_BOOT_MAGIC_SIZE) != 0) {
+		return false;
+	}
+
+	if (hdr_v0->header_version >= 3U) {
+		page_size = ANDROID_BOOT_V3_PAGE_SIZE;
+		layout->kernel_size = hdr_v3->kernel_size;
+		layout->ramdisk_size = hdr_v3->ramdisk_size;
+	} else {
+		page_size = hdr_v0->page_size;
+		layout->kernel_size = hdr_v0->kernel_size;
+		layout->ramdisk_size = hdr_v0->ramdisk_size;
+	}
+
+	if ((page_size == 0ULL) || ((page_size & (page_size - 1ULL)) != 0ULL)) {
+		pr_error("Invalid boot image page size: 0x%"PRIx64"\n", page_size);
+		return false;
+	}
+
+	/* Header occupies the first page, sections are page aligned */
+	layout->kernel_offset = page_size;
+	layout->ramdisk_offset = layout->kernel_offset + ROUND_UP(layout->kernel_size, page_size);
+
+	return true;
+}
+
+#define ARM64_IMAGE_MAGIC	0x644d5241U
+
+/* Header of arm64 kernel Image (Documentation/arm64/booting.txt) */
+struct arm64_image_hdr {
+	uint32_t code0;
+	uint32_t code1;
+	uint64_t text_offset;
+	uint64_t image_size;
+	uint64_t flags;
+	uint64_t res2;
+	uint64_t res3;
+	uint64_t res4;
+	uint32_t magic;
+	uint32_t res5;
+};
+
+/* Sizes of the kernel and ramdisk being placed in OS carveout, known only
+ * from the header of their boot image; kernel footprint is 0 if unknown */
+static bool os_image_sizes_known;
+static uint64_t os_kernel_footprint;
+static uint64_t os_ramdisk_size;
+/* Room left in OS carveout below the kernel load address, for the headers of
+ * a boot image loaded in place */
+static uint64_t os_kernel_prefix;
+
+/**
+ * @brief Get the memory footprint of an uncompressed arm64 kernel Image
+ *
+ * @param image_hdr Header of the kernel Image
+ *
+ * @return Memory footprint of the kernel from its load address, 0 if it
+ *         cannot be determined from the header
+ */
+static uint64_t arm64_image_footprint(const struct arm64_image_hdr *image_hdr)
+{
+	uint64_t text_offset;
+
+	if ((image_hdr->magic != ARM64_IMAGE_MAGIC) || (image_hdr->image_size == 0ULL)) {
+		return 0;
+	}
+
+	text_offset = MAX(image_hdr->text_offset, tegrabl_get_kernel_text_offset());
+
+	return ROUND_UP(text_offset + image_hdr->image_size, KERNEL_ALIGNMENT);
+}
+
+/**
+ * @brief Size the placement of the kernel and ramdisk in OS carveout from the
+ * boot image they come from. Must be called by the loader with the boot image
+ * (once verified) before the kernel and ramdisk load addresses are requested;
+ * without it, the worst case sizes are reserved.
+ *
+ * @param bootimg Pointer to the boot image
+ * @param size Size of the boot image buffer
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_INVALID if bootimg is not
+ *         a boot image (worst case sizes are reserved then)
+ */
+tegrabl_error_t tegrabl_set_boot_img_layout(const void *bootimg, uint64_t size)
+{
+	struct bootimg_layout layout;
+
+	os_image_sizes_known = false;
+	os_kernel_footprint = 0;
+	os_ramdisk_size = 0;
+
+	if ((bootimg == NULL) || (size < sizeof(struct bootimg_hdr_v0)) ||
+		!parse_bootimg_hdr(bootimg, &layout)) {
+		return TEGRABL_ERROR(TEGRABL_ERR_INVALID, 2);
+	}
+
+	if ((layout.kernel_size >= sizeof(struct arm64_image_hdr)) &&
+		(size >= sizeof(struct arm64_image_hdr)) &&
+		(layout.kernel_offset <= (size - sizeof(struct arm64_image_hdr)))) {
+		os_kernel_footprint = arm64_image_footprint((const struct arm64_image_hdr *)
+													((uintptr_t)bootimg + layout.kernel_offset));
+	}
+	os_ramdisk_size = layout.ramdisk_size;
+	os_image_sizes_known = true;
+
+	return TEGRABL_NO_ERROR;
+}
+
+/* Memory footprint of the kernel from its load address */
+static uint64_t get_kernel_footprint(void)
+{
+	return (os_kernel_footprint != 0ULL) ? os_kernel_footprint : MAX_KERNEL_IMAGE_SIZE;
+}
+
+/* Size of the ramdisk */
+static uint64_t get_ramdisk_footprint(void)
+{
+	return os_image_sizes_known ? os_ramdisk_size : RAMDISK_MAX_SIZE;
+}
+
+/**
+ * @brief Allocate space for an image in OS carveout. Images are packed one
+ * after the other in the order of request.
+ *
+ * @param size Size of the image
+ * @param alignment Alignment of the image, must be a power of 2
+ * @param name Name of the image, for logs
+ *
+ * @return Load address of the image, 0 if it does not fit in OS carveout
+ */
+static uint64_t os_carveout_alloc(uint64_t size, uint64_t alignment, const char *name)
+{
+	uint64_t os_end;
+	uint64_t addr;
+
+	os_end = boot_params->carveout_info[CARVEOUT_OS].base +
+		boot_params->carveout_info[CARVEOUT_OS].size;
+
+	addr = ROUND_UP(os_carveout_next_free_addr, alignment);
+	if ((addr > os_end) || (size > (os_end - addr))) {
+		pr_error("%s (0x%"PRIx64" bytes @ 0x%"PRIx64") exceeds OS carveout\n", name, size, addr);
+		return 0;
+	}
+
+	pr_trace("%s(): %s: 0x%"PRIx64" + 0x%"PRIx64"\n", __func__, name, addr, size);
+
+	/* Update next free addr ptr */
+	os_carveout_next_free_addr = addr + size;
+
+	return addr;
+}
+
 uint64_t tegrabl_get_kernel_load_addr(void)
 {
 	uint64_t kernel_load_addr;
 
 	pr_trace("%s(): %u\n", __func__, __LINE__);
 
-	kernel_load_addr = boot_params->carveout_info[CARVEOUT_OS].base;
+#if defined(CONFIG_ENABLE_STAGED_SCRUBBING)
+	/* Images get loaded to OS carveout, make sure it is scrubbed. Rest of the
+	 * DRAM may still be scrubbed in background. */
+	if (tegrabl_sdram_qual_engine_wait_for_range(boot_params->carveout_info[CARVEOUT_OS].base,
+			boot_params->carveout_info[CARVEOUT_OS].size) != TEGRABL_NO_ERROR) {
+		pr_error("OS carveout scrub failed\n");
+	}
+#endif
+
+	kernel_load_addr = boot_params->carveout_info[CARVEOUT_OS].base + os_kernel_prefix;
 	kernel_load_addr = ROUND_UP(kernel_load_addr, KERNEL_ALIGNMENT);
 	pr_trace("%s(): %u, kernel load addr: 0x%"PRIx64"\n", __func__, __LINE__, kernel_load_addr);
 
-	/* Update next free addr ptr */
+	/* Reserve the space needed by the kernel */
 	if (os_carveout_next_free_addr == 0ULL) {
-		os_carveout_next_free_addr = kernel_load_addr + MAX_KERNEL_IMAGE_SIZE;
+		os_carveout_next_free_addr = kernel_load_addr;
+		if (os_carveout_alloc(get_kernel_footprint(), KERNEL_ALIGNMENT, "kernel") == 0ULL) {
+			os_carveout_next_free_addr = 0;
+			return 0;
+		}
 	}
 
 	return kernel_load_addr;
@@ -1616,15 +2058,18 @@ uint64_t tegrabl_get_dtb_load_addr(void)
 	pr_trace("%s(): %u\n", __func__, __LINE__);
 
 	/* Get next free addr ptr */
-	if (os_carveout_next_free_addr == 0ULL) {
-		tegrabl_get_kernel_load_addr();
+	if ((os_carveout_next_free_addr == 0ULL) && (tegrabl_get_kernel_load_addr() == 0ULL)) {
+		return 0;
 	}
 
-	dtb_load_addr = ROUND_UP((uintptr_t)os_carveout_next_free_addr, DTB_ALIGNMENT);
+	/* DTB size is not known before it is loaded and it grows with the DT
+	 * fixups, so always reserve the max size for it */
+	dtb_load_addr = os_carveout_alloc(DTB_MAX_SIZE, DTB_ALIGNMENT, "dtb");
 	pr_trace("%s(): %u, dtb load addr: 0x%"PRIx64"\n", __func__, __LINE__, dtb_load_addr);
 
-	/* Update next free addr ptr */
-	os_carveout_next_free_addr = dtb_load_addr + DTB_MAX_SIZE;
+#if defined(CONFIG_ENABLE_STAGED_SCRUBBING)
+	dram_scrub_poll();
+#endif
 
 	return dtb_load_addr;
 }
@@ -1636,19 +2081,255 @@ uint64_t tegrabl_get_ramdisk_load_addr(void)
 	pr_trace("%s(): %u\n", __func__, __LINE__);
 
 	/* Update next free addr ptr */
-	if (os_carveout_next_free_addr == 0ULL) {
-		tegrabl_get_kernel_load_addr();
+	if ((os_carveout_next_free_addr == 0ULL) && (tegrabl_get_kernel_load_addr() == 0ULL)) {
+		return 0;
 	}
 
-	ramdisk_load_addr = ROUND_UP(os_carveout_next_free_addr, RAMDISK_ALIGNMENT);
+	ramdisk_load_addr = os_carveout_alloc(get_ramdisk_footprint(), RAMDISK_ALIGNMENT, "ramdisk");
 	pr_trace("%s(): %u, ramdisk load addr: 0x%"PRIx64"\n", __func__, __LINE__, ramdisk_load_addr);
 
-	/* Update next free addr ptr */
-	os_carveout_next_free_addr = ramdisk_load_addr + RAMDISK_MAX_SIZE;
+#if defined(CONFIG_ENABLE_STAGED_SCRUBBING)
+	dram_scrub_poll();
+#endif
 
 	return ramdisk_load_addr;
 }
 
+/* Forget the placement of the images in OS carveout */
+static void os_carveout_reset(void)
+{
+	os_carveout_next_free_addr = 0;
+	os_kernel_prefix = 0;
+	os_image_sizes_known = false;
+	os_kernel_footprint = 0;
+	os_ramdisk_size = 0;
+}
+
+static tegrabl_error_t read_partition_at(struct tegrabl_partition *part, uint64_t offset,
+										 void *buf, uint64_t size)
+{
+	tegrabl_error_t err;
+
+	err = tegrabl_partition_seek(part, offset, TEGRABL_PARTITION_SEEK_SET);
+	if (err != TEGRABL_NO_ERROR) {
+		return err;
+	}
+
+	return tegrabl_partition_read(part, buf, size);
+}
+
+/**
+ * @brief Load the boot image of a partition with its kernel read straight to
+ * the kernel load address
+ *
+ * Only the BCH, the boot image header and the kernel Image header are read
+ * first. The boot image is then placed in OS carveout such that its kernel
+ * section sits at the kernel load address, and read there at once: no staging
+ * buffer in DMA heap and no copy of the kernel. Nothing in it is used before:
+ *  - with CONFIG_ENABLE_SECURE_BOOT, the ratchet level and the signature of
+ *    the BCH are checked and the payload authenticated (and decrypted),
+ *  - verify (AVB) has accepted the boot image,
+ *  - the header parsed again from the verified image matches the placement.
+ * The ramdisk is then moved out to the ramdisk load address.
+ *
+ * Must be called before any image is placed in OS carveout. The kernel and
+ * ramdisk load addresses are returned in kernel and ramdisk and must not be
+ * requested again.
+ *
+ * @param partition_name Name of the partition holding the boot image
+ * @param bin_type Binary type of the boot image, for authentication
+ * @param verify Function verifying the boot image, with priv as argument
+ * @param priv Argument passed to verify
+ * @param kernel (output) Load address and size of the kernel
+ * @param ramdisk (output) Load address and size of the ramdisk
+ *
+ * @return TEGRABL_NO_ERROR if successful, TEGRABL_ERR_NOT_SUPPORTED if the
+ *         image cannot be loaded in place (no BCH, header not readable before
+ *         authentication, compressed kernel) and the staged path has to be
+ *         used, else appropriate error
+ */
+tegrabl_error_t tegrabl_load_bootimg_in_place(const char *partition_name, tegrabl_binary_type_t bin_type,
+											  tegrabl_bootimg_verify_fn_t verify, void *priv,
+											  struct tegrabl_linuxboot_memblock *kernel,
+											  struct tegrabl_linuxboot_memblock *ramdisk)
+{
+	struct tegrabl_partition part;
+	NvBootComponentHeader *bch = NULL;
+	struct arm64_image_hdr image_hdr;
+	struct bootimg_layout layout;
+	struct bootimg_layout verified;
+	const uint64_t bch_size = sizeof(NvBootComponentHeader);
+	uint64_t mem_hdr_size;
+	uint64_t image_size;
+	uint64_t footprint;
+	uint64_t kernel_addr;
+	uint64_t ramdisk_addr;
+	uint64_t os_end;
+	uint8_t *base;
+	tegrabl_error_t err;
+
+	if ((partition_name == NULL) || (verify == NULL) || (kernel == NULL) || (ramdisk == NULL)) {
+		return TEGRABL_ERROR(TEGRABL_ERR_INVALID, 3);
+	}
+
+	if (os_carveout_next_free_addr != 0ULL) {
+		pr_error("OS carveout is in use, cannot load boot image in place\n");
+		return TEGRABL_ERROR(TEGRABL_ERR_INVALID, 4);
+	}
+
+	err = tegrabl_partition_open(partition_name, &part);
+	if (err != TEGRABL_NO_ERROR) {
+		pr_error("Failed to open %s partition\n", partition_name);
+		return err;
+	}
+
+	/* BCH and boot image header */
+	bch = tegrabl_malloc(bch_size + sizeof(struct bootimg_hdr_v0));
+	if (bch == NULL) {
+		err = TEGRABL_ERROR(TEGRABL_ERR_NO_MEMORY, 0);
+		goto fail;
+	}
+	err = read_partition_at(&part, 0, bch, bch_size + sizeof(struct bootimg_hdr_v0));
+	if (err != TEGRABL_NO_ERROR) {
+		goto fail;
+	}
+
+	if (memcmp(bch->HeaderMagic, "NVDA", 4) != 0) {
+		pr_info("No BCH in %s partition, cannot load it in place\n", partition_name);
+		err = TEGRABL_ERROR(TEGRABL_ERR_NOT_SUPPORTED, 0);
+		goto fail;
+	}
+	image_size = bch->Stage2Components[0].BinaryLen;
+	if ((image_size < sizeof(struct bootimg_hdr_v0)) ||
+		(image_size > (tegrabl_partition_size(&part) - bch_size))) {
+		pr_error("Invalid boot image size 0x%"PRIx64" in %s partition\n", image_size, partition_name);
+		err = TEGRABL_ERROR(TEGRABL_ERR_INVALID, 5);
+		goto fail;
+	}
+
+	/* Encrypted header cannot be parsed before it gets authenticated */
+	if (!parse_bootimg_hdr((uint8_t *)bch + bch_size, &layout)) {
+		pr_info("Boot image header of %s partition is not readable, cannot load it in place\n",
+				partition_name);
+		err = TEGRABL_ERROR(TEGRABL_ERR_NOT_SUPPORTED, 1);
+		goto fail;
+	}
+	if ((layout.kernel_size < sizeof(image_hdr)) || (layout.ramdisk_offset > image_size) ||
+		(layout.ramdisk_size > (image_size - layout.ramdisk_offset))) {
+		pr_error("Invalid boot image in %s partition\n", partition_name);
+		err = TEGRABL_ERROR(TEGRABL_ERR_INVALID, 6);
+		goto fail;
+	}
+
+	/* Kernel Image header, to know the kernel footprint */
+	err = read_partition_at(&part, bch_size + layout.kernel_offset, &image_hdr, sizeof(image_hdr));
+	if (err != TEGRABL_NO_ERROR) {
+		goto fail;
+	}
+	footprint = arm64_image_footprint(&image_hdr);
+	if (footprint == 0ULL) {
+		pr_info("Kernel is not a raw arm64 Image, cannot load it in place\n");
+		err = TEGRABL_ERROR(TEGRABL_ERR_NOT_SUPPORTED, 2);
+		goto fail;
+	}
+
+#if defined(CONFIG_ENABLE_SECURE_BOOT)
+	/* BCH gets authenticated in memory, in front of the boot image */
+	mem_hdr_size = bch_size;
+#else
+	mem_hdr_size = 0;
+	TEGRABL_UNUSED(bin_type);
+#endif
+
+	/* Place the boot image such that its kernel lands at the kernel load address */
+	os_kernel_prefix = mem_hdr_size + layout.kernel_offset;
+	os_kernel_footprint = footprint;
+	os_ramdisk_size = layout.ramdisk_size;
+	os_image_sizes_known = true;
+	kernel_addr = tegrabl_get_kernel_load_addr();
+	if (kernel_addr == 0ULL) {
+		err = TEGRABL_ERROR(TEGRABL_ERR_NO_MEMORY, 1);
+		goto fail;
+	}
+	os_end = boot_params->carveout_info[CARVEOUT_OS].base + boot_params->carveout_info[CARVEOUT_OS].size;
+	if ((mem_hdr_size + image_size - os_kernel_prefix) > (os_end - kernel_addr)) {
+		pr_error("Boot image (0x%"PRIx64" bytes) exceeds OS carveout\n", image_size);
+		err = TEGRABL_ERROR(TEGRABL_ERR_NO_MEMORY, 2);
+		goto fail;
+	}
+	base = (uint8_t *)(uintptr_t)(kernel_addr - os_kernel_prefix);
+
+	err = read_partition_at(&part, bch_size - mem_hdr_size, base, mem_hdr_size + image_size);
+	if (err != TEGRABL_NO_ERROR) {
+		pr_error("Failed to read boot image from %s partition\n", partition_name);
+		goto fail;
+	}
+
+#if defined(CONFIG_ENABLE_SECURE_BOOT)
+	if (((NvBootComponentHeader *)base)->Stage2Components[0].BinaryLen != image_size) {
+		pr_error("BCH of %s partition changed while loading\n", partition_name);
+		err = TEGRABL_ERROR(TEGRABL_ERR_VERIFY_FAILED, 0);
+		goto fail;
+	}
+	if (!tegrabl_do_ratchet_check(bin_type, base)) {
+		err = TEGRABL_ERROR(TEGRABL_ERR_VERIFY_FAILED, 1);
+		goto fail;
+	}
+	/* Boot image gets moved to base, over the BCH */
+	err = tegrabl_auth_payload(bin_type, "kernel", base, (uint32_t)(mem_hdr_size + image_size));
+	if (err != TEGRABL_NO_ERROR) {
+		goto fail;
+	}
+#endif
+
+	err = verify(base, image_size, priv);
+	if (err != TEGRABL_NO_ERROR) {
+		pr_error("Verification of boot image from %s partition failed\n", partition_name);
+		goto fail;
+	}
+
+	/* Header read ahead of the checks has to match the verified one */
+	if (!parse_bootimg_hdr(base, &verified) ||
+		(verified.kernel_offset != layout.kernel_offset) || (verified.kernel_size != layout.kernel_size) ||
+		(verified.ramdisk_offset != layout.ramdisk_offset) || (verified.ramdisk_size != layout.ramdisk_size) ||
+		(arm64_image_footprint((const struct arm64_image_hdr *)(base + verified.kernel_offset)) != footprint)) {
+		pr_error("Boot image of %s partition changed while loading\n", partition_name);
+		err = TEGRABL_ERROR(TEGRABL_ERR_VERIFY_FAILED, 2);
+		goto fail;
+	}
+
+	err = tegrabl_set_boot_img_layout(base, image_size);
+	if (err != TEGRABL_NO_ERROR) {
+		goto fail;
+	}
+
+	ramdisk_addr = tegrabl_get_ramdisk_load_addr();
+	if (ramdisk_addr == 0ULL) {
+		err = TEGRABL_ERROR(TEGRABL_ERR_NO_MEMORY, 3);
+		goto fail;
+	}
+	/* Source and destination may overlap */
+	memmove((void *)(uintptr_t)ramdisk_addr, base + verified.ramdisk_offset, verified.ramdisk_size);
+
+	kernel->base = kernel_addr;
+	kernel->size = verified.kernel_size;
+	ramdisk->base = ramdisk_addr;
+	ramdisk->size = verified.ramdisk_size;
+
+	pr_info("Loaded kernel @ 0x%"PRIx64" (0x%"PRIx64"), ramdisk @ 0x%"PRIx64" (0x%"PRIx64")\n",
+			kernel->base, kernel->size, ramdisk->base, ramdisk->size);
+
+fail:
+	if (err != TEGRABL_NO_ERROR) {
+		os_carveout_reset();
+	}
+	if (bch != NULL) {
+		tegrabl_free(bch);
+	}
+	tegrabl_partition_close(&part);
+	return err;
+}
+
 uint64_t tegrabl_get_kernel_text_offset(void)
 {
 	return 0x80000;
@@ -281,3 +281,54 @@ struct odmdata_params odmdata_array[ODMDATA_PROP_TYPE_MAX] = {
 	},
 };
 
+/*
+ * Number of HSIO UPHY lanes owned by C0, C1, C2, C3 and C4 in each
+ * pcie-xbar-<C0>-<C1>-<C2>-<C3>-<C4> configuration, indexed by the value of
+ * the PCIE_XBAR field.
+ */
+static const uint8_t pcie_xbar_lanes[][5] = {
+	{ 2, 1, 1, 1, 2 },	/* pcie-xbar-2-1-1-1-2 */
+	{ 4, 1, 0, 1, 2 },	/* pcie-xbar-4-1-0-1-2 */
+	{ 4, 1, 1, 1, 2 },	/* pcie-xbar-4-1-1-1-2 */
+	{ 4, 0, 0, 1, 2 },	/* pcie-xbar-4-0-0-1-2 */
+	{ 4, 1, 0, 1, 2 },	/* pcie-xbar-4-1-0-1-2-c1l6 */
+	{ 4, 0, 1, 1, 2 },	/* pcie-xbar-4-0-1-1-2 */
+	{ 4, 1, 1, 1, 2 },	/* pcie-xbar-4-1-1-1-2-c1l6 */
+	{ 2, 1, 1, 0, 4 },	/* pcie-xbar-2-1-1-0-4 */
+	{ 2, 1, 1, 1, 4 },	/* pcie-xbar-2-1-1-1-4 */
+	{ 4, 1, 0, 0, 4 },	/* pcie-xbar-4-1-0-0-4 */
+	{ 4, 1, 0, 1, 4 },	/* pcie-xbar-4-1-0-1-4 */
+	{ 4, 1, 1, 0, 4 },	/* pcie-xbar-4-1-1-0-4 */
+	{ 4, 1, 1, 1, 4 },	/* pcie-xbar-4-1-1-1-4 */
+	{ 8, 1, 0, 0, 0 },	/* pcie-xbar-8-1-0-0-0 */
+	{ 8, 1, 0, 1, 0 },	/* pcie-xbar-8-1-0-1-0 */
+	{ 8, 0, 0, 0, 2 },	/* pcie-xbar-8-0-0-0-2 */
+	{ 8, 1, 1, 0, 0 },	/* pcie-xbar-8-1-1-0-0 */
+	{ 8, 1, 1, 1, 0 },	/* pcie-xbar-8-1-1-1-0 */
+	{ 8, 0, 1, 0, 2 },	/* pcie-xbar-8-0-1-0-2 */
+	{ 8, 1, 0, 0, 1 },	/* pcie-xbar-8-1-0-0-1 */
+	{ 8, 1, 0, 1, 1 },	/* pcie-xbar-8-1-0-1-1 */
+	{ 8, 1, 0, 0, 2 },	/* pcie-xbar-8-1-0-0-2 */
+	{ 8, 1, 0, 1, 2 },	/* pcie-xbar-8-1-0-1-2 */
+	{ 8, 1, 1, 0, 1 },	/* pcie-xbar-8-1-1-0-1 */
+	{ 8, 1, 1, 1, 1 },	/* pcie-xbar-8-1-1-1-1 */
+};
+
+uint8_t tegrabl_odmdata_get_pcie_num_lanes(uint8_t ctrl_num)
+{
+	uint32_t odmdata = tegrabl_odmdata_get();
+	uint32_t xbar;
+
+	/* C5 sits on the NVHS UPHY, which it owns entirely when enabled */
+	if (ctrl_num == PCIE_NVHS_CTRL_NUM) {
+		return ((odmdata & NVHS_UPHY_MASK) == NVHS_UPHY_PCIE_C5_VAL) ? PCIE_NVHS_NUM_LANES : 0U;
+	}
+
+	xbar = (odmdata & PCIE_XBAR_MASK) >> PCIE_XBAR_BIT_OFFSET;
+	if ((xbar >= (sizeof(pcie_xbar_lanes) / sizeof(pcie_xbar_lanes[0]))) ||
+		(ctrl_num >= sizeof(pcie_xbar_lanes[0]))) {
+		return 0U;
+	}
+
+	return pcie_xbar_lanes[xbar][ctrl_num];
+}
@@ -14,6 +14,7 @@
 
 #include "build_config.h"
 #include <stdint.h>
+#include <stdbool.h>
 #include <inttypes.h>
 #include <t194_nvg.h>
 #include <tegrabl_debug.h>
@@ -47,27 +48,67 @@ uint32_t tegrabl_ccplex_nvg_num_cores(void)
 	return data.bits.num_cores;
 }
 
-uint32_t tegrabl_ccplex_nvg_logical_to_mpidr(uint32_t core)
+static uint32_t nvg_read_mpidr(uint32_t core)
 {
-	uint32_t num_cores;
-	uint32_t ret = 0;
 	nvg_logical_to_mpidr_channel_t ch_data;
 
-	num_cores = tegrabl_ccplex_nvg_num_cores();
-	if (core < num_cores) {
-		tegrabl_write_nvg_channel_idx((uint32_t)TEGRA_NVG_CHANNEL_LOGICAL_TO_MPIDR);
+	tegrabl_write_nvg_channel_idx((uint32_t)TEGRA_NVG_CHANNEL_LOGICAL_TO_MPIDR);
+
+	/* Write the logical core id */
+	ch_data.flat = 0x0ULL;
+	ch_data.write.lcore_id = core;
+	tegrabl_write_nvg_channel_data(ch_data.flat);
+
+	/* Read-back the MPIDR */
+	ch_data.flat = tegrabl_read_nvg_channel_data();
+
+	return ch_data.read.mpidr;
+}
+
+const struct tegrabl_ccplex_nvg_topology *tegrabl_ccplex_nvg_get_topology(void)
+{
+	static struct tegrabl_ccplex_nvg_topology topology;
+	static bool is_topology_valid;
+	uint32_t core;
+	uint32_t cluster;
+
+	if (is_topology_valid) {
+		return &topology;
+	}
+
+	topology.num_cores = tegrabl_ccplex_nvg_num_cores();
+	if (topology.num_cores > TEGRABL_CCPLEX_NVG_MAX_CORES) {
+		pr_warn("NVG: num cores %u exceeds max %u\n", topology.num_cores,
+				TEGRABL_CCPLEX_NVG_MAX_CORES);
+		topology.num_cores = TEGRABL_CCPLEX_NVG_MAX_CORES;
+	}
+
+	topology.cluster_mask = 0;
+	for (core = 0; core < topology.num_cores; core++) {
+		topology.mpidr[core] = nvg_read_mpidr(core);
+
+		/* Aff1 of MPIDR is the cluster id */
+		cluster = (topology.mpidr[core] >> 8) & 0xffU;
+		if (cluster < TEGRABL_CCPLEX_NVG_MAX_CLUSTERS) {
+			topology.cluster_mask |= (1UL << cluster);
+		}
+
+		pr_info("NVG: Logical CPU: %u; MPIDR: 0x%x\n", core, topology.mpidr[core]);
+	}
 
-		/* Write the logical core id */
-		ch_data.flat = 0x0ULL;
-		ch_data.write.lcore_id = core;
-		tegrabl_write_nvg_channel_data(ch_data.flat);
+	is_topology_valid = true;
 
-		/* Read-back the MPIDR */
-		ch_data.flat = tegrabl_read_nvg_channel_data();
+	return &topology;
+}
 
-		pr_info("NVG: Logical CPU: %u; MPIDR: 0x%x\n", core, ch_data.read.mpidr);
+uint32_t tegrabl_ccplex_nvg_logical_to_mpidr(uint32_t core)
+{
+	const struct tegrabl_ccplex_nvg_topology *topology;
+	uint32_t ret = 0;
 
-		ret = ch_data.read.mpidr;
+	topology = tegrabl_ccplex_nvg_get_topology();
+	if (core < topology->num_cores) {
+		ret = topology->mpidr[core];
 	} else {
 		pr_error("Core: %u is not present\n", core);
 	}
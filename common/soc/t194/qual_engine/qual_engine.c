@@ -26,6 +26,8 @@
 #include <tegrabl_addressmap.h>
 #include <tegrabl_soc_misc.h>
 #include <tegrabl_timer.h>
+#include <tegrabl_profiler.h>
+#include <inttypes.h>
 
 #define QUAL_PAGE_SIZE_SHIFT (14)
 
@@ -34,6 +36,60 @@
 /* FIXME: Silicon: 15seconds. Optimize this */
 #define SCRUB_TIMEOUT (15 * 1000 * 1000)
 
+/* Throughput assumed until the first region has been measured (~16 GB/s) */
+#define QUAL_ENGINE_DEFAULT_BYTES_PER_US (16ULL * 1024ULL)
+/* Bounds of the status poll interval */
+#define QUAL_ENGINE_MIN_POLL_US (1ULL)
+#define QUAL_ENGINE_MAX_POLL_US (1000ULL)
+/* Poll granularity once the expected completion time has passed */
+#define QUAL_ENGINE_TAIL_POLL_DIV (64ULL)
+/* Completion noticed within this time of the last busy status is timed */
+#define QUAL_ENGINE_TIMED_GAP_US (2ULL * QUAL_ENGINE_MAX_POLL_US)
+
+/* Profiler records carry no payload, throughput goes in the record name */
+#define QUAL_ENGINE_PROFILER_STR_LEN (48U)
+
+/**
+ * @brief Region queued for scrubbing
+ */
+struct qual_engine_scrub_region {
+	uint64_t base;
+	uint64_t size;
+};
+
+/**
+ * @brief Region currently being scrubbed by HW
+ */
+struct qual_engine_active_region {
+	uint64_t base;
+	uint64_t size;
+	time_t start_time_us;
+	/* Last time HW was seen busy with the region */
+	time_t last_busy_us;
+};
+
+static struct qual_engine_active_region active_region;
+static struct tegrabl_qual_engine_scrub_stats scrub_stats;
+
+/**
+ * @brief Queue of regions to be scrubbed one after the other in background
+ *
+ * @param regions Queued regions
+ * @param next Index of the next region to be started
+ * @param count Number of queued regions
+ * @param is_busy true if region (next - 1) is being scrubbed by HW
+ * @param err Sticky error of the queue
+ */
+struct qual_engine_scrub_queue {
+	struct qual_engine_scrub_region regions[QUAL_ENGINE_MAX_QUEUED_REGIONS];
+	uint32_t next;
+	uint32_t count;
+	bool is_busy;
+	tegrabl_error_t err;
+};
+
+static struct qual_engine_scrub_queue scrub_queue;
+
 tegrabl_error_t tegrabl_sdram_qual_engine_init(uint64_t phy_addr_start, uint64_t size)
 {
 	uint32_t page_start;
@@ -55,6 +111,11 @@ tegrabl_error_t tegrabl_sdram_qual_engine_init(uint64_t phy_addr_start, uint64_t
 				page_start, page_end);
 		is_fpga = tegrabl_is_fpga();
 
+		active_region.base = phy_addr_start;
+		active_region.size = size;
+		active_region.start_time_us = tegrabl_get_timestamp_us();
+		active_region.last_busy_us = active_region.start_time_us;
+
 		err = tegrabl_qualengine_init_scrub(page_start, page_end, is_fpga);
 		if (err != TEGRABL_NO_ERROR) {
 			pr_error("qual scrub failed\n");
@@ -64,28 +125,235 @@ tegrabl_error_t tegrabl_sdram_qual_engine_init(uint64_t phy_addr_start, uint64_t
 	return err;
 }
 
-tegrabl_error_t tegrabl_sdram_qual_engine_wait_for_idle(void)
+/*
+ * Account the active region once HW reports it done. HW finished somewhere
+ * between the last busy status and now; only if that window is narrow is the
+ * region timed and used for the throughput estimate, else (region completed
+ * in background while nobody polled) just the bounds are logged.
+ */
+static void qual_engine_region_done(void)
 {
-	tegrabl_error_t error = TEGRABL_NO_ERROR;
-	time_t start_time_us = tegrabl_get_timestamp_us();
-	time_t timeout_us;
+	time_t end_time_us = tegrabl_get_timestamp_us();
+	time_t elapsed_us = end_time_us - active_region.start_time_us;
+	uint64_t mb_per_s = 0;
+	char profiler_str[QUAL_ENGINE_PROFILER_STR_LEN];
+
+	scrub_stats.num_regions++;
+	scrub_stats.total_bytes += active_region.size;
+	scrub_stats.total_time_us += elapsed_us;
 
+	if ((end_time_us - active_region.last_busy_us) > QUAL_ENGINE_TIMED_GAP_US) {
+		pr_info("scrub: 0x%"PRIx64" + 0x%"PRIx64" done in %"PRIu64" to %"PRIu64" us (start %"PRIu64")\n",
+				active_region.base, active_region.size,
+				(uint64_t)(active_region.last_busy_us - active_region.start_time_us),
+				(uint64_t)elapsed_us, (uint64_t)active_region.start_time_us);
+		return;
+	}
+
+	scrub_stats.timed_bytes += active_region.size;
+	scrub_stats.timed_time_us += elapsed_us;
+
+	if (elapsed_us != 0ULL) {
+		/* bytes/us is the same as MB/s (decimal) */
+		mb_per_s = active_region.size / elapsed_us;
+	}
+
+	pr_info("scrub: 0x%"PRIx64" + 0x%"PRIx64" in %"PRIu64" us (start %"PRIu64", end %"PRIu64"), "
+			"%"PRIu64".%02"PRIu64" GB/s\n", active_region.base, active_region.size,
+			(uint64_t)elapsed_us, (uint64_t)active_region.start_time_us, (uint64_t)end_time_us,
+			mb_per_s / 1000ULL, (mb_per_s % 1000ULL) / 10ULL);
+
+	(void)tegrabl_snprintf(profiler_str, sizeof(profiler_str), "DRAM scrub %"PRIu64"MB %"PRIu64".%02"PRIu64"GB/s",
+						   active_region.size >> 20, mb_per_s / 1000ULL, (mb_per_s % 1000ULL) / 10ULL);
+	tegrabl_profiler_record(profiler_str, 0, DETAILED);
+}
+
+/**
+ * @brief Compute how long to wait before next status check of the active
+ * region, from its size and the throughput measured so far. Polls sparsely
+ * until the expected completion time and then at a fine granularity.
+ */
+static time_t qual_engine_poll_interval(void)
+{
+	uint64_t bytes_per_us = QUAL_ENGINE_DEFAULT_BYTES_PER_US;
+	uint64_t expected_us;
+	uint64_t elapsed_us;
+	uint64_t interval_us;
+
+	if ((scrub_stats.timed_time_us != 0ULL) &&
+		(scrub_stats.timed_bytes >= scrub_stats.timed_time_us)) {
+		bytes_per_us = scrub_stats.timed_bytes / scrub_stats.timed_time_us;
+	}
+
+	expected_us = active_region.size / bytes_per_us;
+	elapsed_us = tegrabl_get_timestamp_us() - active_region.start_time_us;
+
+	if (elapsed_us < expected_us) {
+		/* Halve the remaining time at each check */
+		interval_us = (expected_us - elapsed_us) / 2ULL;
+	} else {
+		interval_us = expected_us / QUAL_ENGINE_TAIL_POLL_DIV;
+	}
+
+	if (interval_us < QUAL_ENGINE_MIN_POLL_US) {
+		interval_us = QUAL_ENGINE_MIN_POLL_US;
+	} else if (interval_us > QUAL_ENGINE_MAX_POLL_US) {
+		interval_us = QUAL_ENGINE_MAX_POLL_US;
+	}
+
+	return interval_us;
+}
+
+void tegrabl_sdram_qual_engine_get_stats(struct tegrabl_qual_engine_scrub_stats *stats)
+{
+	if (stats != NULL) {
+		*stats = scrub_stats;
+	}
+}
+
+static time_t qual_engine_get_timeout(void)
+{
 	if (tegrabl_is_fpga()) {
-		timeout_us = SCRUB_TIMEOUT_FPGA;
+		return SCRUB_TIMEOUT_FPGA;
 	} else {
-		timeout_us = SCRUB_TIMEOUT;
+		return SCRUB_TIMEOUT;
 	}
+}
+
+tegrabl_error_t tegrabl_sdram_qual_engine_wait_for_idle(void)
+{
+	tegrabl_error_t error = TEGRABL_NO_ERROR;
+	time_t start_time_us = tegrabl_get_timestamp_us();
+	time_t timeout_us = qual_engine_get_timeout();
 
 	/* status of Qual Engine (0=IDLE, 1=BUSY) */
 	while (tegrabl_qualengine_check_status()) {
-		if ((tegrabl_get_timestamp_us() - start_time_us) > timeout_us) {
+		active_region.last_busy_us = tegrabl_get_timestamp_us();
+		if ((active_region.last_busy_us - start_time_us) > timeout_us) {
 			pr_error("Qual engine NOT idle post timeout\n");
 			error = TEGRABL_ERROR(TEGRABL_ERR_TIMEOUT, 0);
 			break;
 		}
 		/* delay before next check */
-		tegrabl_udelay(1ULL);
+		tegrabl_udelay(qual_engine_poll_interval());
+	}
+
+	if (error == TEGRABL_NO_ERROR) {
+		qual_engine_region_done();
 	}
 	return error;
 }
 
+
+tegrabl_error_t tegrabl_sdram_qual_engine_queue_scrub(uint64_t phy_addr_start, uint64_t size)
+{
+	if (size == 0ULL) {
+		return TEGRABL_NO_ERROR;
+	}
+
+	if ((MOD_LOG2(phy_addr_start, QUAL_PAGE_SIZE_SHIFT) != 0ULL) ||
+		(MOD_LOG2(size, QUAL_PAGE_SIZE_SHIFT) != 0ULL)) {
+		pr_warn("start address / size should be aligned to page size.\n");
+		return TEGRABL_ERROR(TEGRABL_ERR_BAD_ADDRESS, 0);
+	}
+
+	if (scrub_queue.count >= QUAL_ENGINE_MAX_QUEUED_REGIONS) {
+		pr_error("scrub queue full\n");
+		return TEGRABL_ERROR(TEGRABL_ERR_NO_MEMORY, 0);
+	}
+
+	pr_trace("scrub: queue 0x%"PRIx64" + 0x%"PRIx64"\n", phy_addr_start, size);
+
+	scrub_queue.regions[scrub_queue.count].base = phy_addr_start;
+	scrub_queue.regions[scrub_queue.count].size = size;
+	scrub_queue.count++;
+
+	/* Kick the engine right away if it is idle */
+	return tegrabl_sdram_qual_engine_poll();
+}
+
+tegrabl_error_t tegrabl_sdram_qual_engine_poll(void)
+{
+	struct qual_engine_scrub_region *region;
+	tegrabl_error_t err;
+
+	if (scrub_queue.err != TEGRABL_NO_ERROR) {
+		return scrub_queue.err;
+	}
+
+	if (scrub_queue.is_busy) {
+		/* status of Qual Engine (0=IDLE, 1=BUSY) */
+		if (tegrabl_qualengine_check_status()) {
+			active_region.last_busy_us = tegrabl_get_timestamp_us();
+			if ((active_region.last_busy_us - active_region.start_time_us) >
+				qual_engine_get_timeout()) {
+				pr_error("Qual engine NOT idle post timeout\n");
+				scrub_queue.err = TEGRABL_ERROR(TEGRABL_ERR_TIMEOUT, 1);
+			}
+			return scrub_queue.err;
+		}
+		scrub_queue.is_busy = false;
+		qual_engine_region_done();
+	}
+
+	if (scrub_queue.next < scrub_queue.count) {
+		region = &scrub_queue.regions[scrub_queue.next];
+		err = tegrabl_sdram_qual_engine_init(region->base, region->size);
+		if (err != TEGRABL_NO_ERROR) {
+			scrub_queue.err = err;
+			return err;
+		}
+		scrub_queue.next++;
+		scrub_queue.is_busy = true;
+	} else {
+		/* Queue drained, recycle it */
+		scrub_queue.next = 0;
+		scrub_queue.count = 0;
+	}
+
+	return TEGRABL_NO_ERROR;
+}
+
+/* Check whether any region in the queue, which is not yet done, overlaps with given range */
+static bool qual_engine_is_range_pending(uint64_t base, uint64_t size)
+{
+	struct qual_engine_scrub_region *region;
+	uint32_t i;
+
+	i = scrub_queue.next;
+	if (scrub_queue.is_busy) {
+		i--;
+	}
+
+	for (; i < scrub_queue.count; i++) {
+		region = &scrub_queue.regions[i];
+		if ((region->base < (base + size)) && (base < (region->base + region->size))) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+tegrabl_error_t tegrabl_sdram_qual_engine_wait_for_range(uint64_t base, uint64_t size)
+{
+	tegrabl_error_t err = TEGRABL_NO_ERROR;
+
+	while (qual_engine_is_range_pending(base, size)) {
+		err = tegrabl_sdram_qual_engine_poll();
+		if (err != TEGRABL_NO_ERROR) {
+			break;
+		}
+		/* delay before next check */
+		if (scrub_queue.is_busy) {
+			tegrabl_udelay(qual_engine_poll_interval());
+		}
+	}
+
+	return err;
+}
+
+tegrabl_error_t tegrabl_sdram_qual_engine_wait_for_queue(void)
+{
+	return tegrabl_sdram_qual_engine_wait_for_range(0ULL, UINT64_MAX);
+}